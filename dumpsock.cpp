@@ -1,172 +1,6691 @@
-// listens on port 9999 for incoming data, tries to read it all, and dumps it to stdout
-
-#include <chrono>
-#include <cstdio>
-#include <iostream>
-#include <optional>
-#include <string>
-#include <variant>
-#include <vector>
-
-// windows stuff
-#include <fcntl.h>
-#include <io.h>
-#include <winsock2.h>
-#include <WS2tcpip.h>
-
-#undef min
-#undef max
-
-#pragma comment(lib, "Ws2_32.lib")
-
-class SocketDumper {
-private:
-    WSADATA wsaData_;
-    SOCKET socket_;
-    sockaddr_in addr_;
-    SOCKET incomingDataSocket_;
-    std::vector<char> received_;
-
-    std::optional<std::string> error_;
-
-    // create an ipv4 address in the win32 format that all the socket functions expect
-    sockaddr_in sockAddrForPort(uint16_t port) {
-        return {
-            .sin_family = AF_INET,
-            .sin_port = htons(port),
-            .sin_addr = {
-                .S_un = {
-                    .S_un_b = {
-                        .s_b1 = 0,
-                        .s_b2 = 0,
-                        .s_b3 = 0,
-                       .s_b4 = 0
-                   }
-                }
-            }
-        };
-    }
-
-    void setError(std::string msg) {
-        error_ = std::move(msg);
-    }
-
-    boolean hasError() const {
-        return error_.has_value();
-    }
-public:
-    SocketDumper() {}
-
-    void initWsa() {
-        int iResult = WSAStartup(MAKEWORD(2, 2), &wsaData_);
-        if (iResult != 0) {
-            setError("WSAStartup failed: " + std::to_string(iResult));
-        }
-    }
-
-    void initTcpSocket(uint16_t port) {
-        if (hasError()) return;
-
-        socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-        if (socket_ == INVALID_SOCKET) {
-            setError("Couldn't create a tcp socket");
-            return;
-        }
-        addr_ = sockAddrForPort(port);
-    }
-
-    void bindSocket() {
-        if (hasError()) return;
-
-        int result = bind(socket_, (sockaddr*)&addr_, sizeof(sockaddr_in));
-        if (result == SOCKET_ERROR) {
-            setError("socket bind error");
-            return;
-        }
-    }
-
-    void listenSocket() {
-        if (hasError()) return;
-
-        int result = listen(socket_, /*backlog*/1);
-        if (result == SOCKET_ERROR) {
-            setError("socket listen error");
-            return;
-        }
-    }
-
-    void acceptSocket() {
-        if (hasError()) return;
-
-        incomingDataSocket_ = accept(socket_, NULL, NULL);
-        if (incomingDataSocket_ == INVALID_SOCKET) {
-            setError("socket accept error");
-        }
-    }
-
-    void drainSocket() {
-        if (hasError()) return;
-
-        constexpr int buffSize = 4096;
-
-        received_.reserve(1024 * 1024 * 1); // 1MiB
-
-        char buf[buffSize];
-        int result = 0;
-
-        const auto recv_start = std::chrono::high_resolution_clock::now();
-
-        while (result = recv(incomingDataSocket_, buf, buffSize, 0)) {
-            if (result == SOCKET_ERROR) {
-                setError("socket error during read");
-                return;
-            }
-
-            const int readSize = result;
-            received_.insert(received_.end(), buf, buf + readSize);
-        }
-
-        const auto recv_end = std::chrono::high_resolution_clock::now();
-
-        // bytes / ms * 1000 = bytes / s
-        const double Bps = static_cast<double>(received_.size()) / std::chrono::duration_cast<std::chrono::milliseconds>(recv_end - recv_start).count() * 1000.0;
-        const double KiBps = Bps / 1024;
-        const double MiBps = KiBps / 1024;
-
-        const double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(recv_end - recv_start).count() / 1000.0;
-
-        std::cerr << received_.size() << " bytes in " << seconds << "s" << " for " << MiBps << " MiB/s" << std::endl;
-    }
-
-    void dump() {
-        if (hasError()) {
-            std::cerr << *error_ << std::endl;
-        }
-        else {
-            std::fwrite(received_.data(), sizeof(char), received_.size(), stdout);
-        }
-    }
-
-    int getExitCode() {
-        return hasError() ? EXIT_FAILURE : EXIT_SUCCESS;
-    }
-};
-
-void UNUSED(const auto& v) {
-    v;
-}
-
-int main() {
-    int v = _setmode(_fileno(stdout), O_BINARY); // write to stdout in binary mode, not character mode; otherwise windows adds an 0x0D byte for every 0x0A byte
-    UNUSED(v);
-
-    SocketDumper socketDumper{};
-    socketDumper.initWsa();
-    socketDumper.initTcpSocket(9999);
-    socketDumper.bindSocket();
-    socketDumper.listenSocket();
-    socketDumper.acceptSocket();
-    socketDumper.drainSocket();
-    socketDumper.dump();
-    return socketDumper.getExitCode();
-}
+// listens on port 9999 for incoming data, tries to read it all, and dumps it to stdout
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <latch>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+// windows stuff
+#include <winsock2.h>
+#include <WS2tcpip.h>
+#include <bcrypt.h>
+#include <compressapi.h>
+#include <fcntl.h>
+#include <intrin.h>
+#include <io.h>
+#include <mstcpip.h>
+#include <mswsock.h>
+#include <psapi.h>
+#include <sys/stat.h>
+#include <timeapi.h>
+#include <TraceLoggingProvider.h>
+#include <tmmintrin.h>
+#include <winhttp.h>
+
+#undef min
+#undef max
+
+#pragma comment(lib, "Ws2_32.lib")
+#pragma comment(lib, "Cabinet.lib")
+#pragma comment(lib, "bcrypt.lib")
+#pragma comment(lib, "winhttp.lib")
+#pragma comment(lib, "Advapi32.lib")
+#pragma comment(lib, "Psapi.lib")
+#pragma comment(lib, "Winmm.lib")
+
+// etw (tracelogging) provider on the accept, recv, handoff, stage and write paths, so a live receiver can be traced with
+// wpr, perfview or tracelog without a rebuild. TraceLoggingWrite is one enabled check when nobody's listening;
+// anything that costs more than that (timestamps for durations) goes behind traceEnabled()
+// {5b6e1d2a-8f43-4c1e-9a7d-2e9c4b0f6a31}
+TRACELOGGING_DEFINE_PROVIDER(traceProvider, "dumpsock",
+    (0x5b6e1d2a, 0x8f43, 0x4c1e, 0x9a, 0x7d, 0x2e, 0x9c, 0x4b, 0x0f, 0x6a, 0x31));
+
+uint64_t microsecondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// --trace FILE: the same spans the etw events describe, kept in memory and written out as chrome trace json at exit
+// (open it in ui.perfetto.dev or chrome://tracing). each thread appends to a buffer only it touches, so recording never
+// takes a lock; the registry lock is taken once per thread, the first time it records anything.
+// written out only after the transfer, once every thread that recorded has gone idle
+class Timeline {
+private:
+    struct Span {
+        const char* name;
+        const char* category;
+        int64_t beginNs;
+        int64_t durationNs;
+        uint64_t bytes;
+    };
+
+    struct ThreadSpans {
+        DWORD threadId;
+        std::vector<Span> spans;
+    };
+
+    std::atomic<bool> enabled_ = false;
+    std::chrono::high_resolution_clock::time_point origin_;
+    DWORD mainThreadId_ = 0;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadSpans>> threads_;
+
+    static inline thread_local ThreadSpans* current_ = nullptr;
+
+    ThreadSpans& threadSpans() {
+        if (!current_) {
+            auto spans = std::make_unique<ThreadSpans>();
+            spans->threadId = GetCurrentThreadId();
+            spans->spans.reserve(4096);
+            current_ = spans.get();
+            std::lock_guard lock{mutex_};
+            threads_.push_back(std::move(spans));
+        }
+        return *current_;
+    }
+public:
+    void enable() {
+        origin_ = std::chrono::high_resolution_clock::now();
+        mainThreadId_ = GetCurrentThreadId();
+        enabled_ = true;
+    }
+
+    bool enabled() const {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    void record(const char* name, const char* category,
+                std::chrono::high_resolution_clock::time_point begin,
+                std::chrono::high_resolution_clock::time_point end,
+                uint64_t bytes = 0) {
+        if (!enabled()) return;
+        const auto ns = [](auto d) { return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count(); };
+        threadSpans().spans.push_back({name, category, ns(begin - origin_), ns(end - begin), bytes});
+    }
+
+    bool write(const char* path) {
+        std::FILE* file = std::fopen(path, "wb");
+        if (!file) return false;
+
+        std::lock_guard lock{mutex_};
+        std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file);
+        bool first = true;
+        for (const auto& thread : threads_) {
+            std::fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", static_cast<unsigned long>(thread->threadId),
+                thread->threadId == mainThreadId_ ? "receive" : "pool");
+            first = false;
+            for (const Span& span : thread->spans) {
+                std::fprintf(file, ",\n{\"ph\":\"X\",\"name\":\"%s\",\"cat\":\"%s\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"bytes\":%llu}}",
+                    span.name, span.category, static_cast<unsigned long>(thread->threadId),
+                    span.beginNs / 1000.0, span.durationNs / 1000.0, static_cast<unsigned long long>(span.bytes));
+            }
+        }
+        std::fputs("\n]}\n", file);
+        return std::fclose(file) == 0;
+    }
+};
+
+Timeline timeline;
+
+bool traceEnabled() {
+    return timeline.enabled() || TraceLoggingProviderEnabled(traceProvider, 0, 0);
+}
+
+// hdr style histogram: every power of two is split into 32 linear buckets, so any value comes back within about 3%
+// over the whole 64 bit range in a fixed 15KiB. no locking; each thread records into its own and they're merged
+// for the report
+class Histogram {
+private:
+    static constexpr int subBucketBits = 5;
+    static constexpr uint64_t subBucketCount = 1ull << subBucketBits;
+
+    std::array<uint64_t, (64 - subBucketBits + 1) * subBucketCount> counts_{};
+    uint64_t total_ = 0;
+    uint64_t max_ = 0;
+
+    static size_t bucketFor(uint64_t value) {
+        if (value < subBucketCount) return static_cast<size_t>(value);
+        const int shift = std::bit_width(value) - subBucketBits - 1;
+        return (shift + 1) * subBucketCount + ((value >> shift) - subBucketCount);
+    }
+
+    // the largest value that lands in the bucket
+    static uint64_t bucketTop(size_t bucket) {
+        if (bucket < subBucketCount) return bucket;
+        const int shift = static_cast<int>(bucket / subBucketCount) - 1;
+        const uint64_t bottom = (bucket % subBucketCount + subBucketCount) << shift;
+        return bottom + ((1ull << shift) - 1);
+    }
+public:
+    void record(uint64_t value) {
+        counts_[bucketFor(value)]++;
+        total_++;
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const Histogram& other) {
+        for (size_t i = 0; i < counts_.size(); i++) counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t count() const { return total_; }
+
+    // smallest recorded value that at least `percent` of the values are at or below
+    uint64_t percentile(double percent) const {
+        if (total_ == 0) return 0;
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percent / 100 * total_)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); i++) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(bucketTop(i), max_);
+        }
+        return max_;
+    }
+
+    // "p50 x, p90 x, p99 x, p99.9 x, max x" with every value divided by `scale`
+    void describe(std::ostream& os, double scale, const char* unit) const {
+        os << "p50 " << percentile(50) / scale << unit
+           << ", p90 " << percentile(90) / scale << unit
+           << ", p99 " << percentile(99) / scale << unit
+           << ", p99.9 " << percentile(99.9) / scale << unit
+           << ", max " << max_ / scale << unit;
+    }
+};
+
+// what the process has spent so far: cycles on every thread, cycles on the calling thread, cpu time, page faults.
+// the difference of two samples around a phase, divided by the bytes it moved, says whether a change made that phase
+// do less work or only moved the work somewhere else
+struct CpuCounters {
+    uint64_t processCycles = 0;
+    uint64_t threadCycles = 0;
+    uint64_t userTime = 0;   // 100ns
+    uint64_t kernelTime = 0; // 100ns
+    uint64_t pageFaults = 0;
+
+    static CpuCounters sample() {
+        CpuCounters c;
+        ULONG64 cycles = 0;
+        if (QueryProcessCycleTime(GetCurrentProcess(), &cycles)) c.processCycles = cycles;
+        if (QueryThreadCycleTime(GetCurrentThread(), &cycles)) c.threadCycles = cycles;
+
+        FILETIME creation, exit, kernel, user;
+        if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+            c.kernelTime = (static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+            c.userTime = (static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+        }
+
+        PROCESS_MEMORY_COUNTERS memory{};
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory))) c.pageFaults = memory.PageFaultCount;
+        return c;
+    }
+
+    CpuCounters operator-(const CpuCounters& earlier) const {
+        return {
+            processCycles - earlier.processCycles,
+            threadCycles - earlier.threadCycles,
+            userTime - earlier.userTime,
+            kernelTime - earlier.kernelTime,
+            pageFaults - earlier.pageFaults,
+        };
+    }
+
+    // everything per GB of `bytes`; `thread` names whichever thread took both samples
+    void report(std::ostream& os, const char* phase, const char* thread, uint64_t bytes) const {
+        const double gb = bytes / 1e9;
+        if (gb <= 0) return;
+        os << "  " << phase << " per GB: "
+           << processCycles / gb / 1e6 << "M cycles (" << threadCycles / gb / 1e6 << "M on the " << thread << " thread), "
+           << userTime / gb / 1e4 << "ms user, " << kernelTime / gb / 1e4 << "ms kernel, "
+           << pageFaults / gb << " page faults" << std::endl;
+    }
+};
+
+// a run of bytes moving between pipeline stages
+using Chunk = std::vector<char>;
+
+// fixed capacity fifo between two pipeline stages
+// push blocks while the queue is full, so a slow stage pushes back on everything upstream of it
+// pop blocks while the queue is empty and returns nullopt once the queue is closed and drained
+template <typename T>
+class BoundedQueue {
+private:
+    std::mutex mutex_;
+    std::condition_variable notFull_;
+    std::condition_variable notEmpty_;
+    std::deque<T> items_;
+    const size_t capacity_;
+    size_t maxDepth_ = 0;
+    bool closed_ = false;
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+    void push(T item) {
+        std::unique_lock lock{mutex_};
+        notFull_.wait(lock, [&] { return items_.size() < capacity_ || closed_; });
+        items_.push_back(std::move(item));
+        maxDepth_ = std::max(maxDepth_, items_.size());
+        notEmpty_.notify_one();
+    }
+
+    // push, or false straight away if it's full; for dropping rather than waiting
+    bool tryPush(T item) {
+        std::lock_guard lock{mutex_};
+        if (items_.size() >= capacity_ || closed_) return false;
+        items_.push_back(std::move(item));
+        maxDepth_ = std::max(maxDepth_, items_.size());
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    std::optional<T> pop() {
+        std::unique_lock lock{mutex_};
+        notEmpty_.wait(lock, [&] { return !items_.empty() || closed_; });
+        if (items_.empty()) return std::nullopt;
+        T item = std::move(items_.front());
+        items_.pop_front();
+        notFull_.notify_one();
+        return item;
+    }
+
+    void close() {
+        std::lock_guard lock{mutex_};
+        closed_ = true;
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    size_t depth() {
+        std::lock_guard lock{mutex_};
+        return items_.size();
+    }
+
+    size_t maxDepth() {
+        std::lock_guard lock{mutex_};
+        return maxDepth_;
+    }
+};
+
+// work stealing pool shared by everything in the pipeline
+// every worker owns a deque and runs its own tasks newest first; a worker that runs dry steals the oldest task
+// from someone else. tasks submitted from a worker land on that worker's own deque, so when a stage fans a stream
+// out into blocks they stay local until an idle worker comes and takes them
+class ThreadPool {
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> pending_ = 0;
+    std::atomic<size_t> nextQueue_ = 0;
+    bool stopping_ = false;
+
+    static inline thread_local ThreadPool* currentPool_ = nullptr;
+    static inline thread_local size_t currentQueue_ = 0;
+
+    std::optional<std::function<void()>> take(size_t self) {
+        {
+            WorkQueue& own = *queues_[self];
+            std::lock_guard lock{own.mutex};
+            if (!own.tasks.empty()) {
+                auto task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return task;
+            }
+        }
+        for (size_t k = 1; k < queues_.size(); k++) {
+            WorkQueue& victim = *queues_[(self + k) % queues_.size()];
+            std::lock_guard lock{victim.mutex};
+            if (!victim.tasks.empty()) {
+                auto task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return task;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void work(size_t self) {
+        currentPool_ = this;
+        currentQueue_ = self;
+        while (true) {
+            if (auto task = take(self)) {
+                pending_--;
+                (*task)();
+                continue;
+            }
+            std::unique_lock lock{sleepMutex_};
+            wake_.wait(lock, [&] { return pending_ > 0 || stopping_; });
+            if (stopping_ && pending_ == 0) return;
+        }
+    }
+public:
+    explicit ThreadPool(size_t threadCount) {
+        threadCount = std::max<size_t>(threadCount, 1);
+        for (size_t i = 0; i < threadCount; i++) {
+            queues_.push_back(std::make_unique<WorkQueue>());
+        }
+        for (size_t i = 0; i < threadCount; i++) {
+            workers_.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock{sleepMutex_};
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t threadCount() const { return workers_.size(); }
+
+    // which worker the calling task runs on, for per-worker state that needs no locking
+    size_t workerIndex() const {
+        return currentPool_ == this ? currentQueue_ : 0;
+    }
+
+    void submit(std::function<void()> task) {
+        // counted before it's visible so a worker that finds it never takes pending_ below zero
+        pending_++;
+        const size_t target = currentPool_ == this ? currentQueue_ : nextQueue_++ % queues_.size();
+        {
+            WorkQueue& queue = *queues_[target];
+            std::lock_guard lock{queue.mutex};
+            queue.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard lock{sleepMutex_};
+        }
+        wake_.notify_one();
+    }
+};
+
+// a setting the auto tuner may move at runtime: an ordered list of values, lowest first, and the one in use.
+// apply() runs on the tuner's thread, so whatever it sets has to be safe to change under a running transfer
+struct TuningKnob {
+    std::string name;
+    std::vector<size_t> values;
+    size_t at = 0;
+    std::function<void(size_t)> apply;
+    std::function<std::string(size_t)> label = [](size_t value) { return std::to_string(value); };
+};
+
+// one transform sitting between receive and output
+// process() is handed each chunk in order and may append any number of bytes (including none) to `out`;
+// finish() is called once after the last chunk to flush anything the stage held back
+class Stage {
+private:
+    mutable std::mutex errorMutex_;
+    mutable std::optional<std::string> error_;
+protected:
+    // safe to call from any thread, including from a const transformBlock(); the first error wins
+    void setError(std::string msg) const {
+        std::lock_guard lock{errorMutex_};
+        if (!error_) error_ = std::move(msg);
+    }
+public:
+    virtual ~Stage() = default;
+
+    virtual const char* name() const = 0;
+    virtual void process(std::span<const char> in, Chunk& out) = 0;
+    virtual void finish(Chunk& out) {}
+
+    // called on the stage's own thread before each chunk (or block) with how full its input queue is, 0 to 1;
+    // a queue that stays full means everything upstream is waiting on this stage
+    virtual void observeBacklog(double fill) {}
+
+    // anything worth telling the user once the transfer is done (checksums and such), one line, no newline
+    virtual std::string summary() const { return {}; }
+
+    // a setting the stage would rather have tuned than fixed; once handed out the tuner owns it
+    virtual std::optional<TuningKnob> tuningKnob() { return std::nullopt; }
+
+    std::optional<std::string> error() const {
+        std::lock_guard lock{errorMutex_};
+        return error_;
+    }
+};
+
+// a stage whose work splits into independent fixed size blocks
+// the pipeline cuts the stream into blockSize() blocks (the last one may be short), runs transformBlock() on whichever
+// pool worker is free, and puts the results back in stream order before calling blockDone() and passing them on
+class BlockStage : public Stage {
+private:
+    Chunk pending_;
+    uint64_t nextIndex_ = 0;
+
+    void runBlock(std::span<const char> block, Chunk& out) {
+        Chunk blockOut;
+        transformBlock(nextIndex_, block, blockOut);
+        blockDone(nextIndex_, block.size(), blockOut);
+        out.insert(out.end(), blockOut.begin(), blockOut.end());
+        nextIndex_++;
+    }
+public:
+    virtual size_t blockSize() const = 0;
+
+    // runs concurrently with other blocks of the same stream, so it must leave the stage's own state alone
+    virtual void transformBlock(uint64_t index, std::span<const char> in, Chunk& out) const = 0;
+
+    // runs in stream order on the stage's own thread, once every earlier block has been handed on
+    virtual void blockDone(uint64_t index, size_t inSize, Chunk& out) {}
+
+    // serial fallback for running the stage outside a pipeline
+    void process(std::span<const char> in, Chunk& out) final {
+        while (!in.empty()) {
+            const size_t take = std::min(in.size(), blockSize() - pending_.size());
+            pending_.insert(pending_.end(), in.begin(), in.begin() + take);
+            in = in.subspan(take);
+            if (pending_.size() == blockSize()) {
+                runBlock(pending_, out);
+                pending_.clear();
+            }
+        }
+    }
+
+    void finish(Chunk& out) override {
+        if (!pending_.empty()) runBlock(pending_, out);
+        pending_.clear();
+    }
+};
+
+// passes everything through untouched and reports the crc32 of the stream
+class Crc32Stage : public Stage {
+private:
+    uint32_t crc_ = 0xFFFFFFFF;
+
+    static const std::array<uint32_t, 256>& table() {
+        static const std::array<uint32_t, 256> t = [] {
+            std::array<uint32_t, 256> t{};
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+        return t;
+    }
+public:
+    const char* name() const override { return "crc32"; }
+
+    void process(std::span<const char> in, Chunk& out) override {
+        const auto& t = table();
+        for (char c : in) crc_ = t[(crc_ ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc_ >> 8);
+        out.insert(out.end(), in.begin(), in.end());
+    }
+
+    std::string summary() const override {
+        char hex[9];
+        std::snprintf(hex, sizeof(hex), "%08x", crc_ ^ 0xFFFFFFFF);
+        return hex;
+    }
+};
+
+// drops every 0x0D that comes right before an 0x0A, for text sent from a windows machine
+class StripCrStage : public Stage {
+private:
+    bool pendingCr_ = false;
+public:
+    const char* name() const override { return "strip-cr"; }
+
+    void process(std::span<const char> in, Chunk& out) override {
+        for (char c : in) {
+            if (pendingCr_ && c != '\n') out.push_back('\r');
+            pendingCr_ = c == '\r';
+            if (!pendingCr_) out.push_back(c);
+        }
+    }
+
+    void finish(Chunk& out) override {
+        if (pendingCr_) out.push_back('\r');
+        pendingCr_ = false;
+    }
+};
+
+std::optional<uint64_t> parseCount(std::string_view text) {
+    uint64_t value = 0;
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end != text.data() + text.size()) return std::nullopt;
+    return value;
+}
+
+void appendLe32(Chunk& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+uint32_t readLe32(const char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+    return value;
+}
+
+void appendLe64(Chunk& out, uint64_t value) {
+    appendLe32(out, static_cast<uint32_t>(value));
+    appendLe32(out, static_cast<uint32_t>(value >> 32));
+}
+
+uint64_t readLe64(const char* in) {
+    return readLe32(in) | static_cast<uint64_t>(readLe32(in + 4)) << 32;
+}
+
+// layout of a seekable capture, all integers little endian:
+//   frame...   every block of the stream compressed on its own (or stored as is)
+//   entry...   one per frame: u32 compressed size, u32 decompressed size, u32 method
+//   footer     u32 frame count, u32 block size, u32 magic
+// the seek table sits at the end like zstd's seekable format, so a reader starts from the footer and works back
+namespace seekable {
+    constexpr uint32_t magic = 0x544B5344; // "DSKT"
+    constexpr size_t entrySize = 12;
+    constexpr size_t footerSize = 12;
+    constexpr size_t blockSize = 1024 * 1024 * 1; // 1MiB, what the compress stage cuts the stream into, so no frame holds more
+    constexpr uint32_t methodStored = 0; // otherwise one of the COMPRESS_ALGORITHM_* values
+
+    struct Entry {
+        uint32_t compressedSize;
+        uint32_t decompressedSize;
+        uint32_t method;
+    };
+
+    std::optional<uint32_t> methodForName(std::string_view name) {
+        if (name == "xpress") return COMPRESS_ALGORITHM_XPRESS;
+        if (name == "xpress-huff") return COMPRESS_ALGORITHM_XPRESS_HUFF;
+        if (name == "lzms") return COMPRESS_ALGORITHM_LZMS;
+        if (name == "mszip") return COMPRESS_ALGORITHM_MSZIP;
+        return std::nullopt;
+    }
+
+    const char* methodName(uint32_t method) {
+        switch (method) {
+            case methodStored: return "stored";
+            case COMPRESS_ALGORITHM_XPRESS: return "xpress";
+            case COMPRESS_ALGORITHM_XPRESS_HUFF: return "xpress-huff";
+            case COMPRESS_ALGORITHM_LZMS: return "lzms";
+            case COMPRESS_ALGORITHM_MSZIP: return "mszip";
+            default: return "unknown";
+        }
+    }
+}
+
+// compressor handles aren't safe to share between threads and aren't free to create,
+// so every pool thread keeps one per algorithm for as long as it lives
+COMPRESSOR_HANDLE threadCompressor(uint32_t method) {
+    struct Compressors {
+        std::map<uint32_t, COMPRESSOR_HANDLE> handles;
+        ~Compressors() {
+            for (auto& [method, handle] : handles) CloseCompressor(handle);
+        }
+    };
+    static thread_local Compressors compressors;
+
+    auto it = compressors.handles.find(method);
+    if (it != compressors.handles.end()) return it->second;
+
+    COMPRESSOR_HANDLE handle = nullptr;
+    if (!CreateCompressor(method | COMPRESS_RAW, nullptr, &handle)) return nullptr;
+    compressors.handles.emplace(method, handle);
+    return handle;
+}
+
+// order 0 entropy of a block in bits per byte, estimated from a sample: sampleRuns evenly spaced runs of sampleRunSize
+// bytes, so local structure (text lines, repeated records) still shows up in the estimate.
+// the histogram is split four ways and summed at the end so consecutive equal bytes don't serialize on one counter
+double sampledEntropy(std::span<const char> block) {
+    constexpr size_t sampleRuns = 16;
+    constexpr size_t sampleRunSize = 4096;
+
+    std::array<std::array<uint32_t, 256>, 4> counts{};
+    size_t sampled = 0;
+    auto count = [&](std::span<const char> run) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(run.data());
+        size_t i = 0;
+        for (; i + 4 <= run.size(); i += 4) {
+            counts[0][bytes[i]]++;
+            counts[1][bytes[i + 1]]++;
+            counts[2][bytes[i + 2]]++;
+            counts[3][bytes[i + 3]]++;
+        }
+        for (; i < run.size(); i++) counts[0][bytes[i]]++;
+        sampled += run.size();
+    };
+
+    if (block.size() <= sampleRuns * sampleRunSize) {
+        count(block);
+    }
+    else {
+        const size_t stride = block.size() / sampleRuns;
+        for (size_t r = 0; r < sampleRuns; r++) count(block.subspan(r * stride, sampleRunSize));
+    }
+    if (sampled == 0) return 0;
+
+    double entropy = 0;
+    for (int b = 0; b < 256; b++) {
+        const uint32_t n = counts[0][b] + counts[1][b] + counts[2][b] + counts[3][b];
+        if (n == 0) continue;
+        const double p = static_cast<double>(n) / sampled;
+        entropy -= p * std::log2(p);
+    }
+    return entropy;
+}
+
+// compresses every block into an independent frame and finishes the stream with a seek table,
+// so the pool can compress blocks in parallel and a reader can decompress any byte range on its own.
+//
+// blocks that look incompressible (encrypted, already compressed) are stored without trying. unless pinned to one
+// method, the stage also walks a ladder of methods from fast to thorough: when its input queue backs up (receive is
+// outrunning compression) it steps to a faster method, and when the queue stays near empty it steps back up
+class CompressStage : public BlockStage {
+private:
+    static constexpr double incompressibleEntropy = 7.5; // bits per byte
+    static constexpr std::array<uint32_t, 3> ladder = {
+        COMPRESS_ALGORITHM_XPRESS,
+        COMPRESS_ALGORITHM_XPRESS_HUFF,
+        COMPRESS_ALGORITHM_LZMS,
+    };
+
+    const bool adaptive_;
+    bool tuned_ = false; // the auto tuner picks the method instead of the backlog
+    std::atomic<uint32_t> method_;
+    double backlog_ = 0.5; // smoothed input queue fill, 0 to 1
+    std::vector<seekable::Entry> seekTable_;
+    std::map<uint32_t, uint64_t> framesByMethod_;
+    uint64_t bytesIn_ = 0;
+    uint64_t bytesOut_ = 0;
+
+    // transformBlock runs off the stage's thread, so the method it picked rides along as one trailing byte
+    // that blockDone strips off again before the frame goes downstream
+    void compressBlock(std::span<const char> in, Chunk& out) const {
+        out.assign(in.begin(), in.end());
+        if (sampledEntropy(in) > incompressibleEntropy) return;
+
+        const uint32_t method = method_.load(std::memory_order_relaxed);
+        COMPRESSOR_HANDLE compressor = threadCompressor(method);
+        if (!compressor) {
+            setError("CreateCompressor failed: " + std::to_string(GetLastError()));
+            return;
+        }
+
+        // anything that doesn't come out smaller than it went in is stored as is instead
+        Chunk compressed(in.size());
+        SIZE_T compressedSize = 0;
+        if (!Compress(compressor, in.data(), in.size(), compressed.data(), compressed.size(), &compressedSize)) {
+            if (GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
+                setError("Compress failed: " + std::to_string(GetLastError()));
+            }
+            return;
+        }
+        if (compressedSize >= in.size()) return;
+
+        compressed.resize(compressedSize);
+        compressed.push_back(static_cast<char>(method));
+        out = std::move(compressed);
+    }
+public:
+    // with no method given the stage adapts, starting from xpress-huff
+    explicit CompressStage(std::optional<uint32_t> method)
+        : adaptive_(!method.has_value())
+        , method_(method.value_or(COMPRESS_ALGORITHM_XPRESS_HUFF)) {}
+
+    const char* name() const override { return "compress"; }
+    size_t blockSize() const override { return seekable::blockSize; }
+
+    void observeBacklog(double fill) override {
+        if (!adaptive_ || tuned_) return;
+
+        backlog_ = 0.8 * backlog_ + 0.2 * fill;
+        const uint32_t method = method_.load(std::memory_order_relaxed);
+        const size_t rung = std::find(ladder.begin(), ladder.end(), method) - ladder.begin();
+        if (backlog_ > 0.75 && rung > 0) {
+            method_ = ladder[rung - 1];
+            backlog_ = 0.5;
+        }
+        else if (backlog_ < 0.1 && rung + 1 < ladder.size()) {
+            method_ = ladder[rung + 1];
+            backlog_ = 0.5;
+        }
+    }
+
+    std::optional<TuningKnob> tuningKnob() override {
+        if (!adaptive_) return std::nullopt;
+        tuned_ = true;
+        TuningKnob knob{"compression"};
+        knob.values.assign(ladder.begin(), ladder.end());
+        knob.at = std::find(ladder.begin(), ladder.end(), method_.load()) - ladder.begin();
+        knob.apply = [this](size_t method) { method_ = static_cast<uint32_t>(method); };
+        knob.label = [](size_t method) { return std::string{seekable::methodName(static_cast<uint32_t>(method))}; };
+        return knob;
+    }
+
+    void transformBlock(uint64_t index, std::span<const char> in, Chunk& out) const override {
+        compressBlock(in, out);
+        if (out.size() == in.size()) out.push_back(static_cast<char>(seekable::methodStored));
+    }
+
+    void blockDone(uint64_t index, size_t inSize, Chunk& out) override {
+        const uint32_t method = static_cast<uint8_t>(out.back());
+        out.pop_back();
+        seekTable_.push_back({static_cast<uint32_t>(out.size()), static_cast<uint32_t>(inSize), method});
+        framesByMethod_[method]++;
+        bytesIn_ += inSize;
+        bytesOut_ += out.size();
+    }
+
+    void finish(Chunk& out) override {
+        BlockStage::finish(out);
+        for (const auto& entry : seekTable_) {
+            appendLe32(out, entry.compressedSize);
+            appendLe32(out, entry.decompressedSize);
+            appendLe32(out, entry.method);
+        }
+        appendLe32(out, static_cast<uint32_t>(seekTable_.size()));
+        appendLe32(out, static_cast<uint32_t>(blockSize()));
+        appendLe32(out, seekable::magic);
+    }
+
+    std::string summary() const override {
+        const double ratio = bytesOut_ ? static_cast<double>(bytesIn_) / bytesOut_ : 0;
+        std::string summary = std::to_string(seekTable_.size()) + " frames, ratio " + std::to_string(ratio) + " (";
+        for (const auto& [method, frames] : framesByMethod_) {
+            if (summary.back() != '(') summary += ", ";
+            summary += seekable::methodName(method) + std::string{" "} + std::to_string(frames);
+        }
+        return summary + ")";
+    }
+};
+
+// reads byte ranges back out of a capture written by the compress stage, decompressing only the frames they touch
+class SeekableCapture {
+private:
+    std::FILE* file_ = nullptr;
+    std::vector<seekable::Entry> entries_;
+    std::vector<uint64_t> compressedOffsets_;
+    std::vector<uint64_t> decompressedOffsets_;
+    uint64_t decompressedSize_ = 0;
+
+    std::optional<std::string> error_;
+
+    void setError(std::string msg) {
+        error_ = std::move(msg);
+    }
+
+    bool readAt(uint64_t offset, char* buf, size_t size) {
+        return _fseeki64(file_, static_cast<long long>(offset), SEEK_SET) == 0
+            && std::fread(buf, 1, size, file_) == size;
+    }
+public:
+    ~SeekableCapture() {
+        if (file_) std::fclose(file_);
+    }
+
+    void open(const char* path) {
+        file_ = std::fopen(path, "rb");
+        if (!file_) {
+            setError(std::string{"couldn't open "} + path);
+            return;
+        }
+
+        _fseeki64(file_, 0, SEEK_END);
+        const uint64_t fileSize = static_cast<uint64_t>(_ftelli64(file_));
+        char footer[seekable::footerSize];
+        if (fileSize < seekable::footerSize || !readAt(fileSize - seekable::footerSize, footer, sizeof(footer))
+            || readLe32(footer + 8) != seekable::magic) {
+            setError("not a seekable capture (no seek table footer)");
+            return;
+        }
+
+        // the frame count sizes the table, so it has to fit in the file before anything is allocated for it
+        const uint32_t frameCount = readLe32(footer);
+        const uint64_t tableSize = uint64_t{frameCount} * seekable::entrySize;
+        if (fileSize < seekable::footerSize + tableSize) {
+            setError("truncated seek table");
+            return;
+        }
+        std::vector<char> table(tableSize);
+        if (!readAt(fileSize - seekable::footerSize - tableSize, table.data(), table.size())) {
+            setError("truncated seek table");
+            return;
+        }
+
+        uint64_t compressedOffset = 0;
+        for (uint32_t i = 0; i < frameCount; i++) {
+            const char* entry = table.data() + i * seekable::entrySize;
+            entries_.push_back({readLe32(entry), readLe32(entry + 4), readLe32(entry + 8)});
+            if (entries_.back().decompressedSize > seekable::blockSize) {
+                setError("corrupt seek table: frame " + std::to_string(i) + " is bigger than a block");
+                return;
+            }
+            compressedOffsets_.push_back(compressedOffset);
+            decompressedOffsets_.push_back(decompressedSize_);
+            compressedOffset += entries_.back().compressedSize;
+            decompressedSize_ += entries_.back().decompressedSize;
+        }
+        // otherwise a frame would run into the table or the footer
+        if (compressedOffset != fileSize - seekable::footerSize - tableSize) {
+            setError("corrupt seek table: its frames add up to " + std::to_string(compressedOffset) + " bytes, the file has "
+                     + std::to_string(fileSize - seekable::footerSize - tableSize));
+        }
+    }
+
+    // writes decompressed bytes [offset, offset + length) to `out`, clamped to the end of the capture
+    void extract(uint64_t offset, uint64_t length, std::FILE* out) {
+        if (error_) return;
+        if (offset >= decompressedSize_) {
+            setError("offset " + std::to_string(offset) + " is past the end of the capture (" + std::to_string(decompressedSize_) + " bytes)");
+            return;
+        }
+
+        const uint64_t end = offset + std::min(length, decompressedSize_ - offset);
+        auto first = std::upper_bound(decompressedOffsets_.begin(), decompressedOffsets_.end(), offset);
+        size_t i = first == decompressedOffsets_.begin() ? 0 : (first - decompressedOffsets_.begin()) - 1;
+
+        std::map<uint32_t, DECOMPRESSOR_HANDLE> decompressors;
+        std::vector<char> compressed;
+        std::vector<char> frame;
+        for (; i < entries_.size() && decompressedOffsets_[i] < end; i++) {
+            const seekable::Entry& entry = entries_[i];
+            compressed.resize(entry.compressedSize);
+            if (!readAt(compressedOffsets_[i], compressed.data(), compressed.size())) {
+                setError("truncated frame " + std::to_string(i));
+                break;
+            }
+
+            if (entry.method == seekable::methodStored) {
+                if (entry.compressedSize != entry.decompressedSize) {
+                    setError("corrupt frame " + std::to_string(i) + " (stored, but sizes differ)");
+                    break;
+                }
+                frame = compressed;
+            }
+            else {
+                DECOMPRESSOR_HANDLE& decompressor = decompressors[entry.method];
+                if (!decompressor && !CreateDecompressor(entry.method | COMPRESS_RAW, nullptr, &decompressor)) {
+                    setError("CreateDecompressor failed: " + std::to_string(GetLastError()));
+                    break;
+                }
+                frame.resize(entry.decompressedSize);
+                SIZE_T decompressedSize = 0;
+                if (!Decompress(decompressor, compressed.data(), compressed.size(), frame.data(), frame.size(), &decompressedSize)
+                    || decompressedSize != entry.decompressedSize) {
+                    setError("corrupt frame " + std::to_string(i));
+                    break;
+                }
+            }
+
+            const uint64_t frameStart = decompressedOffsets_[i];
+            const uint64_t from = std::max(offset, frameStart) - frameStart;
+            const uint64_t to = std::min(end, frameStart + entry.decompressedSize) - frameStart;
+            std::fwrite(frame.data() + from, sizeof(char), to - from, out);
+        }
+
+        for (auto& [method, decompressor] : decompressors) {
+            if (decompressor) CloseDecompressor(decompressor);
+        }
+    }
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+using Digest = std::array<uint8_t, 32>;
+
+// sha-256 over the concatenation of `parts`, through cng; safe to call from any thread
+std::optional<Digest> sha256(std::initializer_list<std::span<const uint8_t>> parts) {
+    static const BCRYPT_ALG_HANDLE alg = [] {
+        BCRYPT_ALG_HANDLE handle = nullptr;
+        if (!BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&handle, BCRYPT_SHA256_ALGORITHM, nullptr, 0))) return BCRYPT_ALG_HANDLE{nullptr};
+        return handle;
+    }();
+    if (!alg) return std::nullopt;
+
+    BCRYPT_HASH_HANDLE hash = nullptr;
+    Digest digest;
+    NTSTATUS status = BCryptCreateHash(alg, &hash, nullptr, 0, nullptr, 0, 0);
+    for (const auto& part : parts) {
+        if (BCRYPT_SUCCESS(status)) status = BCryptHashData(hash, const_cast<PUCHAR>(part.data()), static_cast<ULONG>(part.size()), 0);
+    }
+    if (BCRYPT_SUCCESS(status)) status = BCryptFinishHash(hash, digest.data(), static_cast<ULONG>(digest.size()), 0);
+    if (hash) BCryptDestroyHash(hash);
+    if (!BCRYPT_SUCCESS(status)) return std::nullopt;
+    return digest;
+}
+
+// hmac-sha256 of `data` keyed with `key`, through cng; safe to call from any thread
+std::optional<Digest> hmacSha256(std::span<const uint8_t> key, std::span<const uint8_t> data) {
+    static const BCRYPT_ALG_HANDLE alg = [] {
+        BCRYPT_ALG_HANDLE handle = nullptr;
+        if (!BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&handle, BCRYPT_SHA256_ALGORITHM, nullptr, BCRYPT_ALG_HANDLE_HMAC_FLAG))) return BCRYPT_ALG_HANDLE{nullptr};
+        return handle;
+    }();
+    if (!alg) return std::nullopt;
+
+    BCRYPT_HASH_HANDLE hash = nullptr;
+    Digest digest;
+    NTSTATUS status = BCryptCreateHash(alg, &hash, nullptr, 0, const_cast<PUCHAR>(key.data()), static_cast<ULONG>(key.size()), 0);
+    if (BCRYPT_SUCCESS(status)) status = BCryptHashData(hash, const_cast<PUCHAR>(data.data()), static_cast<ULONG>(data.size()), 0);
+    if (BCRYPT_SUCCESS(status)) status = BCryptFinishHash(hash, digest.data(), static_cast<ULONG>(digest.size()), 0);
+    if (hash) BCryptDestroyHash(hash);
+    if (!BCRYPT_SUCCESS(status)) return std::nullopt;
+    return digest;
+}
+
+std::string toHex(std::span<const uint8_t> bytes) {
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (uint8_t b : bytes) {
+        hex.push_back(digits[b >> 4]);
+        hex.push_back(digits[b & 0xF]);
+    }
+    return hex;
+}
+
+// layout of an encrypted capture:
+//   header   u32 magic, u32 block size, 16 byte salt
+//   block... every block of plaintext sealed on its own: ciphertext then 16 byte gcm tag
+//   final    an empty block with only a tag, marked as the last one
+// each file gets its own key, derived from the master key in the keyfile and the file's random salt,
+// so the block index alone is a safe nonce and blocks can be sealed in any order
+namespace encrypted {
+    constexpr uint32_t magic = 0x454B5344; // "DSKE"
+    constexpr size_t saltSize = 16;
+    constexpr size_t headerSize = 8 + saltSize;
+    constexpr size_t tagSize = 16;
+    constexpr size_t keySize = 32;
+    constexpr size_t nonceSize = 12;
+    constexpr size_t blockSize = 1024 * 1024 * 1; // 1MiB
+
+    // a keyfile is exactly keySize random bytes, as written by --genkey
+    std::optional<std::vector<uint8_t>> readKeyFile(const char* path) {
+        std::FILE* file = std::fopen(path, "rb");
+        if (!file) return std::nullopt;
+        std::vector<uint8_t> key(keySize + 1);
+        const size_t read = std::fread(key.data(), 1, key.size(), file);
+        std::fclose(file);
+        if (read != keySize) return std::nullopt;
+        key.resize(keySize);
+        return key;
+    }
+}
+
+// aes-256-gcm through cng, which runs on aes-ni wherever the cpu has it
+// the nonce is the block index and the additional data flags the final block,
+// so blocks can't be reordered, and a file cut short at a block boundary fails to verify
+class BlockCipher {
+private:
+    BCRYPT_ALG_HANDLE aes_ = nullptr;
+    std::array<uint8_t, encrypted::keySize> key_{};
+
+    std::optional<std::string> error_;
+
+    void setError(std::string msg) {
+        error_ = std::move(msg);
+    }
+
+    // per file key = hmac-sha256(master key, "dumpsock file key" || salt)
+    void deriveKey(std::span<const uint8_t> masterKey, std::span<const uint8_t> salt) {
+        static constexpr char label[] = "dumpsock file key";
+        std::vector<uint8_t> info(label, label + sizeof(label) - 1);
+        info.insert(info.end(), salt.begin(), salt.end());
+
+        const auto key = hmacSha256(masterKey, info);
+        if (!key) {
+            setError("key derivation failed");
+            return;
+        }
+        key_ = *key;
+    }
+
+    // key handles are cheap next to a block's worth of aes, and a fresh one per call keeps threads out of each other's way
+    NTSTATUS run(bool encrypt, uint64_t index, bool last, std::span<const uint8_t> in, uint8_t* out, uint8_t* tag) const {
+        BCRYPT_KEY_HANDLE key = nullptr;
+        NTSTATUS status = BCryptGenerateSymmetricKey(aes_, &key, nullptr, 0, const_cast<PUCHAR>(key_.data()), static_cast<ULONG>(key_.size()), 0);
+        if (!BCRYPT_SUCCESS(status)) return status;
+
+        std::array<uint8_t, encrypted::nonceSize> nonce{};
+        for (int i = 0; i < 8; i++) nonce[i] = static_cast<uint8_t>(index >> (8 * i));
+        uint8_t aad = last ? 1 : 0;
+
+        BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO info;
+        BCRYPT_INIT_AUTH_MODE_INFO(info);
+        info.pbNonce = nonce.data();
+        info.cbNonce = static_cast<ULONG>(nonce.size());
+        info.pbAuthData = &aad;
+        info.cbAuthData = 1;
+        info.pbTag = tag;
+        info.cbTag = encrypted::tagSize;
+
+        ULONG written = 0;
+        PUCHAR input = const_cast<PUCHAR>(in.data());
+        const ULONG size = static_cast<ULONG>(in.size());
+        status = encrypt
+            ? BCryptEncrypt(key, input, size, &info, nullptr, 0, out, size, &written, 0)
+            : BCryptDecrypt(key, input, size, &info, nullptr, 0, out, size, &written, 0);
+        BCryptDestroyKey(key);
+        return status;
+    }
+public:
+    BlockCipher(std::span<const uint8_t> masterKey, std::span<const uint8_t> salt) {
+        NTSTATUS status = BCryptOpenAlgorithmProvider(&aes_, BCRYPT_AES_ALGORITHM, nullptr, 0);
+        if (BCRYPT_SUCCESS(status)) {
+            status = BCryptSetProperty(aes_, BCRYPT_CHAINING_MODE, (PUCHAR)BCRYPT_CHAIN_MODE_GCM, sizeof(BCRYPT_CHAIN_MODE_GCM), 0);
+        }
+        if (!BCRYPT_SUCCESS(status)) {
+            setError("couldn't open aes-gcm: " + std::to_string(status));
+            return;
+        }
+        deriveKey(masterKey, salt);
+    }
+
+    ~BlockCipher() {
+        if (aes_) BCryptCloseAlgorithmProvider(aes_, 0);
+    }
+
+    BlockCipher(const BlockCipher&) = delete;
+    BlockCipher& operator=(const BlockCipher&) = delete;
+
+    // appends ciphertext and tag to `out`; safe to call from several threads at once
+    bool seal(uint64_t index, bool last, std::span<const char> in, Chunk& out) const {
+        const size_t start = out.size();
+        out.resize(start + in.size() + encrypted::tagSize);
+        auto* sealed = reinterpret_cast<uint8_t*>(out.data() + start);
+        return BCRYPT_SUCCESS(run(true, index, last, {reinterpret_cast<const uint8_t*>(in.data()), in.size()}, sealed, sealed + in.size()));
+    }
+
+    // checks the tag on a sealed block and appends its plaintext to `out`
+    bool open(uint64_t index, bool last, std::span<const char> in, Chunk& out) const {
+        if (in.size() < encrypted::tagSize) return false;
+        const size_t size = in.size() - encrypted::tagSize;
+        const size_t start = out.size();
+        out.resize(start + size);
+        std::array<uint8_t, encrypted::tagSize> tag;
+        std::memcpy(tag.data(), in.data() + size, tag.size());
+        return BCRYPT_SUCCESS(run(false, index, last, {reinterpret_cast<const uint8_t*>(in.data()), size}, reinterpret_cast<uint8_t*>(out.data() + start), tag.data()));
+    }
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+// seals the stream in independent 1MiB blocks on the pool, see encrypted:: for the layout
+// goes after compress if both are used; encrypted bytes don't compress
+class EncryptStage : public BlockStage {
+private:
+    std::array<uint8_t, encrypted::saltSize> salt_{};
+    std::unique_ptr<BlockCipher> cipher_;
+    bool headerWritten_ = false;
+    uint64_t blocks_ = 0;
+
+    void writeHeader(Chunk& out) {
+        Chunk header;
+        appendLe32(header, encrypted::magic);
+        appendLe32(header, static_cast<uint32_t>(encrypted::blockSize));
+        header.insert(header.end(), salt_.begin(), salt_.end());
+        out.insert(out.begin(), header.begin(), header.end());
+        headerWritten_ = true;
+    }
+public:
+    explicit EncryptStage(const char* keyFile) {
+        const auto masterKey = encrypted::readKeyFile(keyFile);
+        if (!masterKey) {
+            setError(std::string{"couldn't read a "} + std::to_string(encrypted::keySize) + " byte key from " + keyFile);
+            return;
+        }
+        const NTSTATUS status = BCryptGenRandom(nullptr, salt_.data(), static_cast<ULONG>(salt_.size()), BCRYPT_USE_SYSTEM_PREFERRED_RNG);
+        if (!BCRYPT_SUCCESS(status)) {
+            setError("BCryptGenRandom failed: " + std::to_string(status));
+            return;
+        }
+        cipher_ = std::make_unique<BlockCipher>(*masterKey, salt_);
+        if (cipher_->error()) setError(*cipher_->error());
+    }
+
+    const char* name() const override { return "encrypt"; }
+    size_t blockSize() const override { return encrypted::blockSize; }
+
+    void transformBlock(uint64_t index, std::span<const char> in, Chunk& out) const override {
+        if (!cipher_->seal(index, false, in, out)) setError("BCryptEncrypt failed on block " + std::to_string(index));
+    }
+
+    void blockDone(uint64_t index, size_t inSize, Chunk& out) override {
+        if (!headerWritten_) writeHeader(out);
+        blocks_++;
+    }
+
+    void finish(Chunk& out) override {
+        BlockStage::finish(out);
+        if (!headerWritten_) writeHeader(out);
+        if (!cipher_->seal(blocks_, true, {}, out)) setError("BCryptEncrypt failed on the final block");
+    }
+};
+
+// reverses the encrypt stage, writing plaintext to `out` one verified block at a time
+class EncryptedCapture {
+private:
+    std::FILE* file_ = nullptr;
+    std::optional<std::string> error_;
+
+    void setError(std::string msg) {
+        error_ = std::move(msg);
+    }
+public:
+    ~EncryptedCapture() {
+        if (file_) std::fclose(file_);
+    }
+
+    void decrypt(const char* keyFile, const char* path, std::FILE* out) {
+        const auto masterKey = encrypted::readKeyFile(keyFile);
+        if (!masterKey) {
+            setError(std::string{"couldn't read a "} + std::to_string(encrypted::keySize) + " byte key from " + keyFile);
+            return;
+        }
+        file_ = std::fopen(path, "rb");
+        if (!file_) {
+            setError(std::string{"couldn't open "} + path);
+            return;
+        }
+
+        _fseeki64(file_, 0, SEEK_END);
+        uint64_t remaining = static_cast<uint64_t>(_ftelli64(file_));
+        _fseeki64(file_, 0, SEEK_SET);
+
+        char header[encrypted::headerSize];
+        if (remaining < sizeof(header) || std::fread(header, 1, sizeof(header), file_) != sizeof(header) || readLe32(header) != encrypted::magic) {
+            setError("not an encrypted capture");
+            return;
+        }
+        remaining -= sizeof(header);
+        const size_t blockSize = readLe32(header + 4);
+        const auto* salt = reinterpret_cast<const uint8_t*>(header + 8);
+
+        BlockCipher cipher{*masterKey, {salt, encrypted::saltSize}};
+        if (cipher.error()) {
+            setError(*cipher.error());
+            return;
+        }
+
+        // every block is full size except maybe the last one before the tag-only final block,
+        // so the size of what's left says which is which
+        Chunk sealed;
+        Chunk plain;
+        for (uint64_t index = 0;; index++) {
+            const size_t full = blockSize + encrypted::tagSize;
+            const bool last = remaining == encrypted::tagSize;
+            const size_t size = remaining > full ? full : (last ? encrypted::tagSize : remaining - encrypted::tagSize);
+            if (remaining < encrypted::tagSize) {
+                setError("truncated at block " + std::to_string(index));
+                return;
+            }
+
+            sealed.resize(size);
+            if (std::fread(sealed.data(), 1, size, file_) != size) {
+                setError("read error at block " + std::to_string(index));
+                return;
+            }
+            remaining -= size;
+
+            plain.clear();
+            if (!cipher.open(index, last, sealed, plain)) {
+                setError("block " + std::to_string(index) + " failed to verify (wrong key, or the file was altered)");
+                return;
+            }
+            if (!plain.empty()) std::fwrite(plain.data(), sizeof(char), plain.size(), out);
+            if (last) return;
+        }
+    }
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+// merkle tree over fixed size blocks of a stream, hashed like rfc 6962: leaf = sha256(0x00 || block),
+// node = sha256(0x01 || left || right), and a node without a right sibling moves up a level unchanged.
+//
+// tree file layout, integers little endian:
+//   u32 magic, u32 block size, u32 low and u32 high half of the stream size, u32 leaf count,
+//   then every level's hashes from the leaves up to the root
+class MerkleTree {
+private:
+    static constexpr uint32_t magic = 0x4D4B5344; // "DSKM"
+    static constexpr uint8_t leafPrefix = 0;
+    static constexpr uint8_t nodePrefix = 1;
+
+    uint32_t blockSize_ = 0;
+    uint64_t size_ = 0;
+    std::vector<std::vector<Digest>> levels_; // levels_[0] are the leaves, levels_.back() is just the root
+
+    std::optional<std::string> error_;
+
+    void setError(std::string msg) {
+        error_ = std::move(msg);
+    }
+
+    void mismatches(const MerkleTree& other, size_t level, size_t index, std::vector<uint64_t>& leaves) const {
+        if (levels_[level][index] == other.levels_[level][index]) return;
+        if (level == 0) {
+            leaves.push_back(index);
+            return;
+        }
+        for (size_t child = 2 * index; child < std::min(2 * index + 2, levels_[level - 1].size()); child++) {
+            mismatches(other, level - 1, child, leaves);
+        }
+    }
+public:
+    static std::optional<Digest> hashLeaf(std::span<const char> block) {
+        const uint8_t prefix = leafPrefix;
+        return sha256({{&prefix, 1}, {reinterpret_cast<const uint8_t*>(block.data()), block.size()}});
+    }
+
+    // an empty stream still gets one (empty) leaf so there's always a root
+    void build(std::vector<Digest> leaves, uint64_t size, uint32_t blockSize) {
+        blockSize_ = blockSize;
+        size_ = size;
+        levels_.clear();
+        if (leaves.empty()) {
+            const auto empty = hashLeaf({});
+            if (!empty) {
+                setError("sha256 failed");
+                return;
+            }
+            leaves.push_back(*empty);
+        }
+
+        levels_.push_back(std::move(leaves));
+        while (levels_.back().size() > 1) {
+            const std::vector<Digest>& below = levels_.back();
+            std::vector<Digest> level;
+            for (size_t i = 0; i + 1 < below.size(); i += 2) {
+                const uint8_t prefix = nodePrefix;
+                const auto node = sha256({{&prefix, 1}, below[i], below[i + 1]});
+                if (!node) {
+                    setError("sha256 failed");
+                    return;
+                }
+                level.push_back(*node);
+            }
+            if (below.size() % 2) level.push_back(below.back());
+            levels_.push_back(std::move(level));
+        }
+    }
+
+    void save(const char* path) {
+        Chunk out;
+        appendLe32(out, magic);
+        appendLe32(out, blockSize_);
+        appendLe32(out, static_cast<uint32_t>(size_));
+        appendLe32(out, static_cast<uint32_t>(size_ >> 32));
+        appendLe32(out, static_cast<uint32_t>(levels_[0].size()));
+        for (const auto& level : levels_) {
+            for (const auto& digest : level) out.insert(out.end(), digest.begin(), digest.end());
+        }
+
+        std::FILE* file = std::fopen(path, "wb");
+        if (!file || std::fwrite(out.data(), 1, out.size(), file) != out.size() || std::fclose(file) != 0) {
+            setError(std::string{"couldn't write "} + path);
+        }
+    }
+
+    // reads a tree back and checks that its inner nodes really hash up from its leaves
+    void load(const char* path) {
+        std::FILE* file = std::fopen(path, "rb");
+        if (!file) {
+            setError(std::string{"couldn't open "} + path);
+            return;
+        }
+        _fseeki64(file, 0, SEEK_END);
+        const uint64_t fileSize = static_cast<uint64_t>(_ftelli64(file));
+        _fseeki64(file, 0, SEEK_SET);
+        char header[20];
+        bool gotHeader = std::fread(header, 1, sizeof(header), file) == sizeof(header) && readLe32(header) == magic;
+        if (gotHeader) {
+            // the leaf count has to fit in the file and agree with the size and block size, so a bad one can't size the allocation
+            const uint64_t blockSize = readLe32(header + 4);
+            const uint64_t size = readLe32(header + 8) | uint64_t{readLe32(header + 12)} << 32;
+            const uint64_t leafCount = readLe32(header + 16);
+            gotHeader = blockSize != 0 && leafCount * sizeof(Digest) <= fileSize - sizeof(header)
+                && leafCount == std::max<uint64_t>(1, size / blockSize + (size % blockSize != 0));
+        }
+        std::vector<Digest> leaves(gotHeader ? readLe32(header + 16) : 0);
+        const bool gotLeaves = gotHeader && std::fread(leaves.data(), sizeof(Digest), leaves.size(), file) == leaves.size();
+        std::vector<Digest> stored;
+        Digest digest;
+        while (std::fread(digest.data(), 1, digest.size(), file) == digest.size()) stored.push_back(digest);
+        std::fclose(file);
+        if (!gotLeaves) {
+            setError(std::string{path} + " isn't a merkle tree");
+            return;
+        }
+
+        build(std::move(leaves), readLe32(header + 8) | uint64_t{readLe32(header + 12)} << 32, readLe32(header + 4));
+        if (error_) return;
+        std::vector<Digest> inner;
+        for (size_t level = 1; level < levels_.size(); level++) inner.insert(inner.end(), levels_[level].begin(), levels_[level].end());
+        if (inner != stored) setError(std::string{path} + " is corrupt: its inner nodes don't match its leaves");
+    }
+
+    // leaves that differ between two trees over streams cut into the same block size, found by only descending into
+    // subtrees whose roots differ. trees with different leaf counts have different shapes, so those compare leaf by leaf
+    std::vector<uint64_t> mismatchedLeaves(const MerkleTree& other) const {
+        std::vector<uint64_t> leaves;
+        if (levels_[0].size() == other.levels_[0].size()) {
+            mismatches(other, levels_.size() - 1, 0, leaves);
+            return leaves;
+        }
+        for (size_t i = 0; i < std::max(levels_[0].size(), other.levels_[0].size()); i++) {
+            if (i >= levels_[0].size() || i >= other.levels_[0].size() || levels_[0][i] != other.levels_[0][i]) leaves.push_back(i);
+        }
+        return leaves;
+    }
+
+    const Digest& root() const { return levels_.back()[0]; }
+    const Digest& leaf(uint64_t index) const { return levels_[0][index]; }
+    uint64_t leafCount() const { return levels_[0].size(); }
+    uint32_t blockSize() const { return blockSize_; }
+    uint64_t size() const { return size_; }
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+// passes the stream through untouched while hashing its blocks in parallel into a merkle tree,
+// then writes the tree to a file and reports the root. put it first to cover exactly what came off the socket
+class MerkleStage : public BlockStage {
+private:
+    static constexpr size_t defaultBlockSize = 1024 * 1024 * 1; // 1MiB
+
+    const std::string treePath_;
+    std::vector<Digest> leaves_;
+    uint64_t size_ = 0;
+    MerkleTree tree_;
+public:
+    explicit MerkleStage(std::string treePath) : treePath_(std::move(treePath)) {}
+
+    const char* name() const override { return "merkle"; }
+    size_t blockSize() const override { return defaultBlockSize; }
+
+    // the leaf hash rides along after the block's bytes until blockDone strips it off
+    void transformBlock(uint64_t index, std::span<const char> in, Chunk& out) const override {
+        const auto leaf = MerkleTree::hashLeaf(in);
+        if (!leaf) {
+            setError("sha256 failed on block " + std::to_string(index));
+            return;
+        }
+        out.reserve(in.size() + leaf->size());
+        out.assign(in.begin(), in.end());
+        out.insert(out.end(), leaf->begin(), leaf->end());
+    }
+
+    void blockDone(uint64_t index, size_t inSize, Chunk& out) override {
+        if (out.size() < sizeof(Digest)) return;
+        Digest leaf;
+        std::memcpy(leaf.data(), out.data() + out.size() - leaf.size(), leaf.size());
+        out.resize(out.size() - leaf.size());
+        leaves_.push_back(leaf);
+        size_ += inSize;
+    }
+
+    void finish(Chunk& out) override {
+        BlockStage::finish(out);
+        tree_.build(std::move(leaves_), size_, static_cast<uint32_t>(blockSize()));
+        if (!tree_.error()) tree_.save(treePath_.c_str());
+        if (tree_.error()) setError(*tree_.error());
+    }
+
+    std::string summary() const override {
+        if (tree_.error()) return {};
+        return "root " + toHex(tree_.root()) + ", " + std::to_string(tree_.leafCount()) + " blocks, tree in " + treePath_;
+    }
+};
+
+// stage specs are NAME or NAME:ARG
+std::unique_ptr<Stage> makeStage(std::string_view spec) {
+    const size_t colon = spec.find(':');
+    const std::string_view name = spec.substr(0, colon);
+    const std::string_view arg = colon == std::string_view::npos ? std::string_view{} : spec.substr(colon + 1);
+
+    if (name == "crc32") return std::make_unique<Crc32Stage>();
+    if (name == "strip-cr") return std::make_unique<StripCrStage>();
+    if (name == "compress") {
+        if (arg.empty()) return std::make_unique<CompressStage>(std::nullopt);
+        const auto method = seekable::methodForName(arg);
+        if (!method) return nullptr;
+        return std::make_unique<CompressStage>(*method);
+    }
+    if (name == "encrypt" && !arg.empty()) return std::make_unique<EncryptStage>(std::string{arg}.c_str());
+    if (name == "merkle" && !arg.empty()) return std::make_unique<MerkleStage>(std::string{arg});
+    return nullptr;
+}
+
+// where the pipeline output ends up
+// commit() is called once if the whole transfer went through, abort() otherwise
+class Sink {
+private:
+    std::optional<std::string> error_;
+protected:
+    void setError(std::string msg) {
+        error_ = std::move(msg);
+    }
+public:
+    virtual ~Sink() = default;
+
+    virtual void write(std::span<const char> data) = 0;
+    virtual void commit() {}
+    virtual void abort() {}
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+// holds everything until the transfer completes and only then writes it to stdout,
+// so a read that fails part way doesn't leave half a dump behind
+class StdoutSink : public Sink {
+private:
+    std::vector<char> buffered_;
+public:
+    StdoutSink() {
+        buffered_.reserve(1024 * 1024 * 1); // 1MiB
+    }
+
+    void write(std::span<const char> data) override {
+        buffered_.insert(buffered_.end(), data.begin(), data.end());
+    }
+
+    void commit() override {
+        std::fwrite(buffered_.data(), sizeof(char), buffered_.size(), stdout);
+    }
+};
+
+// arithmetic in GF(2^8) with the 0x11D polynomial, for reed-solomon
+namespace gf256 {
+    struct Tables {
+        std::array<uint8_t, 512> exp{};
+        std::array<uint8_t, 256> log{};
+    };
+
+    const Tables& tables() {
+        static const Tables t = [] {
+            Tables t;
+            uint32_t x = 1;
+            for (int i = 0; i < 255; i++) {
+                t.exp[i] = static_cast<uint8_t>(x);
+                t.log[x] = static_cast<uint8_t>(i);
+                x <<= 1;
+                if (x & 0x100) x ^= 0x11D;
+            }
+            for (int i = 255; i < 512; i++) t.exp[i] = t.exp[i - 255];
+            return t;
+        }();
+        return t;
+    }
+
+    uint8_t mul(uint8_t a, uint8_t b) {
+        if (a == 0 || b == 0) return 0;
+        const Tables& t = tables();
+        return t.exp[t.log[a] + t.log[b]];
+    }
+
+    uint8_t inv(uint8_t a) {
+        const Tables& t = tables();
+        return t.exp[255 - t.log[a]];
+    }
+
+    bool hasSsse3() {
+        static const bool has = [] {
+            int info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 9)) != 0;
+        }();
+        return has;
+    }
+
+    // dst ^= c * src, the inner loop of both encoding and reconstruction.
+    // with ssse3, c * x is looked up 16 bytes at a time as lo[x & 0xF] ^ hi[x >> 4] with pshufb
+    void mulAdd(uint8_t c, const uint8_t* src, uint8_t* dst, size_t n) {
+        if (c == 0) return;
+
+        size_t i = 0;
+        if (hasSsse3()) {
+            alignas(16) uint8_t lo[16];
+            alignas(16) uint8_t hi[16];
+            for (uint8_t x = 0; x < 16; x++) {
+                lo[x] = mul(c, x);
+                hi[x] = mul(c, static_cast<uint8_t>(x << 4));
+            }
+            const __m128i loTable = _mm_load_si128(reinterpret_cast<const __m128i*>(lo));
+            const __m128i hiTable = _mm_load_si128(reinterpret_cast<const __m128i*>(hi));
+            const __m128i nibble = _mm_set1_epi8(0x0F);
+            for (; i + 16 <= n; i += 16) {
+                const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                const __m128i product = _mm_xor_si128(
+                    _mm_shuffle_epi8(loTable, _mm_and_si128(x, nibble)),
+                    _mm_shuffle_epi8(hiTable, _mm_and_si128(_mm_srli_epi64(x, 4), nibble)));
+                __m128i* out = reinterpret_cast<__m128i*>(dst + i);
+                _mm_storeu_si128(out, _mm_xor_si128(_mm_loadu_si128(out), product));
+            }
+        }
+
+        const Tables& t = tables();
+        const int logC = t.log[c];
+        for (; i < n; i++) {
+            if (src[i]) dst[i] ^= t.exp[logC + t.log[src[i]]];
+        }
+    }
+
+    // row i of the systematic generator matrix for k data and m parity shards:
+    // identity rows for the data shards, then cauchy rows 1 / (x_i + y_j), any k of which are invertible
+    std::vector<uint8_t> generatorRow(size_t k, size_t row) {
+        std::vector<uint8_t> coefficients(k);
+        for (size_t j = 0; j < k; j++) {
+            coefficients[j] = row < k
+                ? (row == j ? 1 : 0)
+                : inv(static_cast<uint8_t>(row ^ j)); // x_i = row (>= k), y_j = j, never equal
+        }
+        return coefficients;
+    }
+
+    // inverts a k x k matrix in place by gauss-jordan; false if it's singular
+    bool invert(std::vector<std::vector<uint8_t>>& matrix) {
+        const size_t k = matrix.size();
+        std::vector<std::vector<uint8_t>> inverse(k, std::vector<uint8_t>(k));
+        for (size_t i = 0; i < k; i++) inverse[i][i] = 1;
+
+        for (size_t col = 0; col < k; col++) {
+            size_t pivot = col;
+            while (pivot < k && matrix[pivot][col] == 0) pivot++;
+            if (pivot == k) return false;
+            std::swap(matrix[col], matrix[pivot]);
+            std::swap(inverse[col], inverse[pivot]);
+
+            const uint8_t scale = inv(matrix[col][col]);
+            for (size_t j = 0; j < k; j++) {
+                matrix[col][j] = mul(matrix[col][j], scale);
+                inverse[col][j] = mul(inverse[col][j], scale);
+            }
+            for (size_t row = 0; row < k; row++) {
+                const uint8_t factor = matrix[row][col];
+                if (row == col || factor == 0) continue;
+                for (size_t j = 0; j < k; j++) {
+                    matrix[row][j] ^= mul(factor, matrix[col][j]);
+                    inverse[row][j] ^= mul(factor, inverse[col][j]);
+                }
+            }
+        }
+        matrix = std::move(inverse);
+        return true;
+    }
+}
+
+// layout of an erasure coded capture: the stream is cut into stripes of k shard blocks, zero padded at the end,
+// and every stripe adds m parity blocks. shard i of k + m is one file holding its block of every stripe, then a footer:
+//   u32 magic, u32 k, u32 m, u32 shard index, u32 shard block size, u32 low and u32 high half of the stream size
+// any k of the k + m files are enough to get the stream back
+namespace erasure {
+    constexpr uint32_t magic = 0x43455344; // "DSEC"
+    constexpr size_t footerSize = 28;
+    constexpr size_t shardBlockSize = 64 * 1024; // 64KiB
+
+    std::string shardFileName(size_t index) {
+        return "dumpsock-" + std::to_string(index) + ".shard";
+    }
+}
+
+// writes the stream as k data + m parity reed-solomon shards, one per directory, so losing up to m of the
+// directories (disks) loses nothing. each stripe's shard blocks are written in parallel on the pool while the
+// next stripe fills up; a transfer that fails part way removes its shards again
+class ErasureSink : public Sink {
+private:
+    const size_t k_;
+    const size_t m_;
+    ThreadPool& pool_;
+    std::vector<std::string> paths_;
+    std::vector<std::FILE*> files_;
+    std::vector<std::vector<uint8_t>> parityRows_;
+    std::vector<uint8_t> failed_; // per shard, only touched by that shard's write task until the stripe is waited on
+    std::vector<std::vector<uint8_t>> stripe_;    // k + m shard blocks being filled
+    std::vector<std::vector<uint8_t>> inFlight_;  // the stripe being written
+    std::optional<std::latch> writes_;
+    size_t filled_ = 0;
+    uint64_t size_ = 0;
+
+    void waitForWrites() {
+        if (!writes_) return;
+        writes_->wait();
+        writes_.reset();
+        for (size_t i = 0; i < files_.size(); i++) {
+            if (failed_[i]) setError("write failed on " + paths_[i]);
+        }
+    }
+
+    void flushStripe() {
+        for (size_t i = 0; i < m_; i++) {
+            std::fill(stripe_[k_ + i].begin(), stripe_[k_ + i].end(), 0);
+            for (size_t j = 0; j < k_; j++) {
+                gf256::mulAdd(parityRows_[i][j], stripe_[j].data(), stripe_[k_ + i].data(), erasure::shardBlockSize);
+            }
+        }
+
+        waitForWrites();
+        std::swap(stripe_, inFlight_);
+        writes_.emplace(static_cast<ptrdiff_t>(files_.size()));
+        for (size_t i = 0; i < files_.size(); i++) {
+            pool_.submit([this, i] {
+                const auto t0 = std::chrono::high_resolution_clock::now();
+                if (std::fwrite(inFlight_[i].data(), 1, inFlight_[i].size(), files_[i]) != inFlight_[i].size()) failed_[i] = true;
+                timeline.record("shard write", "sink", t0, std::chrono::high_resolution_clock::now(), inFlight_[i].size());
+                writes_->count_down();
+            });
+        }
+        for (auto& block : stripe_) std::fill(block.begin(), block.end(), 0);
+        filled_ = 0;
+    }
+
+    void closeFiles() {
+        for (auto& file : files_) {
+            if (file && std::fclose(file) != 0 && !error()) setError("close failed");
+            file = nullptr;
+        }
+    }
+public:
+    ErasureSink(size_t k, size_t m, const std::vector<std::string>& dirs, ThreadPool& pool)
+        : k_(k), m_(m), pool_(pool)
+        , failed_(k + m)
+        , stripe_(k + m, std::vector<uint8_t>(erasure::shardBlockSize))
+        , inFlight_(k + m, std::vector<uint8_t>(erasure::shardBlockSize)) {
+        if (k == 0 || k + m > 255 || dirs.size() != k + m) {
+            setError("erasure coding needs 1 to 255 shards and one directory per shard");
+            return;
+        }
+        for (size_t i = 0; i < m; i++) parityRows_.push_back(gf256::generatorRow(k, k + i));
+        for (size_t i = 0; i < dirs.size(); i++) {
+            paths_.push_back(dirs[i] + "\\" + erasure::shardFileName(i));
+            files_.push_back(std::fopen(paths_.back().c_str(), "wb"));
+            if (!files_.back()) {
+                setError("couldn't create " + paths_.back());
+                return;
+            }
+            std::setvbuf(files_.back(), nullptr, _IOFBF, 1024 * 1024 * 1);
+        }
+    }
+
+    ~ErasureSink() {
+        waitForWrites();
+        closeFiles();
+    }
+
+    void write(std::span<const char> data) override {
+        if (error()) return;
+        size_ += data.size();
+        while (!data.empty()) {
+            const size_t shard = filled_ / erasure::shardBlockSize;
+            const size_t offset = filled_ % erasure::shardBlockSize;
+            const size_t take = std::min(data.size(), erasure::shardBlockSize - offset);
+            std::memcpy(stripe_[shard].data() + offset, data.data(), take);
+            data = data.subspan(take);
+            filled_ += take;
+            if (filled_ == k_ * erasure::shardBlockSize) flushStripe();
+        }
+    }
+
+    void commit() override {
+        if (error()) return;
+        if (filled_ > 0) flushStripe();
+        waitForWrites();
+
+        for (size_t i = 0; i < files_.size(); i++) {
+            Chunk footer;
+            appendLe32(footer, erasure::magic);
+            appendLe32(footer, static_cast<uint32_t>(k_));
+            appendLe32(footer, static_cast<uint32_t>(m_));
+            appendLe32(footer, static_cast<uint32_t>(i));
+            appendLe32(footer, static_cast<uint32_t>(erasure::shardBlockSize));
+            appendLe32(footer, static_cast<uint32_t>(size_));
+            appendLe32(footer, static_cast<uint32_t>(size_ >> 32));
+            if (std::fwrite(footer.data(), 1, footer.size(), files_[i]) != footer.size()) setError("write failed on " + paths_[i]);
+        }
+        closeFiles();
+    }
+
+    void abort() override {
+        waitForWrites();
+        closeFiles();
+        for (const auto& path : paths_) std::remove(path.c_str());
+    }
+};
+
+// puts a stream back together from any k shard files of an erasure coded capture, rebuilding missing data shards
+class ErasureCapture {
+private:
+    struct Shard {
+        std::FILE* file;
+        uint32_t index;
+    };
+
+    std::vector<Shard> shards_;
+    uint32_t k_ = 0;
+    uint32_t m_ = 0;
+    uint32_t blockSize_ = 0;
+    uint64_t size_ = 0;
+
+    std::optional<std::string> error_;
+
+    void setError(std::string msg) {
+        error_ = std::move(msg);
+    }
+public:
+    ~ErasureCapture() {
+        for (auto& shard : shards_) std::fclose(shard.file);
+    }
+
+    void open(const std::vector<const char*>& paths) {
+        for (const char* path : paths) {
+            std::FILE* file = std::fopen(path, "rb");
+            char footer[erasure::footerSize];
+            long long fileSize = 0;
+            if (!file || _fseeki64(file, 0, SEEK_END) != 0 || (fileSize = _ftelli64(file)) < static_cast<long long>(sizeof(footer))
+                || _fseeki64(file, -static_cast<long long>(sizeof(footer)), SEEK_END) != 0
+                || std::fread(footer, 1, sizeof(footer), file) != sizeof(footer) || readLe32(footer) != erasure::magic) {
+                if (file) std::fclose(file);
+                std::cerr << "skipping " << path << ": not a shard" << std::endl;
+                continue;
+            }
+            _fseeki64(file, 0, SEEK_SET);
+
+            const uint32_t k = readLe32(footer + 4);
+            const uint32_t m = readLe32(footer + 8);
+            const uint32_t index = readLe32(footer + 12);
+            const uint32_t blockSize = readLe32(footer + 16);
+            const uint64_t size = readLe32(footer + 20) | uint64_t{readLe32(footer + 24)} << 32;
+            // a zero block size would never get through the data, and past 255 shards the code isn't in gf(2^8)
+            if (k == 0 || uint64_t{k} + m > 255 || blockSize == 0
+                || (size > 0 && blockSize > static_cast<uint64_t>(fileSize) - sizeof(footer))) {
+                std::fclose(file);
+                setError(std::string{path} + " has a corrupt footer: k " + std::to_string(k) + ", m " + std::to_string(m)
+                         + ", block size " + std::to_string(blockSize));
+                return;
+            }
+            const bool duplicate = std::any_of(shards_.begin(), shards_.end(), [&](const Shard& s) { return s.index == index; });
+            if (!shards_.empty() && (k != k_ || m != m_ || blockSize != blockSize_ || size != size_)) {
+                std::fclose(file);
+                setError(std::string{path} + " belongs to a different capture");
+                return;
+            }
+            if (duplicate || index >= k + m || shards_.size() == k) {
+                std::fclose(file);
+                continue;
+            }
+            k_ = k;
+            m_ = m;
+            blockSize_ = blockSize;
+            size_ = size;
+            shards_.push_back({file, index});
+        }
+        if (shards_.empty() || shards_.size() < k_) {
+            setError("need " + std::to_string(k_ ? k_ : 1) + " shards, have " + std::to_string(shards_.size()));
+        }
+    }
+
+    void restore(std::FILE* out) {
+        if (error_) return;
+
+        // the rows of the generator matrix for the shards we have, inverted, turn them back into the data shards
+        std::vector<std::vector<uint8_t>> decode;
+        for (const auto& shard : shards_) decode.push_back(gf256::generatorRow(k_, shard.index));
+        if (!gf256::invert(decode)) {
+            setError("shards don't decode");
+            return;
+        }
+
+        std::vector<std::vector<uint8_t>> have(k_, std::vector<uint8_t>(blockSize_));
+        std::vector<uint8_t> data(blockSize_);
+        for (uint64_t written = 0; written < size_;) {
+            for (size_t s = 0; s < k_; s++) {
+                if (std::fread(have[s].data(), 1, blockSize_, shards_[s].file) != blockSize_) {
+                    setError("shard " + std::to_string(shards_[s].index) + " is truncated");
+                    return;
+                }
+            }
+            for (size_t j = 0; j < k_ && written < size_; j++) {
+                std::fill(data.begin(), data.end(), 0);
+                for (size_t s = 0; s < k_; s++) gf256::mulAdd(decode[j][s], have[s].data(), data.data(), blockSize_);
+                const size_t take = static_cast<size_t>(std::min<uint64_t>(blockSize_, size_ - written));
+                if (std::fwrite(data.data(), 1, take, out) != take) {
+                    setError("couldn't write the restored data");
+                    return;
+                }
+                written += take;
+            }
+        }
+        if (std::fflush(out) != 0) setError("couldn't write the restored data");
+    }
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+// just enough of an s3 client for a multipart upload, signed with sigv4.
+// urls are path style, http[s]://host[:port]/bucket/key, so a local s3-compatible server works the same as the real thing.
+// credentials come from AWS_ACCESS_KEY_ID, AWS_SECRET_ACCESS_KEY and AWS_SESSION_TOKEN if set, the region from AWS_REGION
+class S3Client {
+public:
+    struct Response {
+        DWORD status = 0;
+        std::string etag;
+        std::string body;
+    };
+private:
+    bool secure_ = false;
+    std::string hostHeader_;
+    std::string hostName_;
+    INTERNET_PORT port_ = 0;
+    std::string path_; // /bucket/key, uri encoded
+    std::string region_;
+    std::string accessKey_;
+    std::string secretKey_;
+    std::string sessionToken_;
+    HINTERNET session_ = nullptr;
+    HINTERNET connection_ = nullptr;
+
+    std::optional<std::string> error_;
+
+    void setError(std::string msg) {
+        error_ = std::move(msg);
+    }
+
+    static std::string env(const char* name) {
+        const char* value = std::getenv(name);
+        return value ? value : "";
+    }
+
+    // only ever handed ascii: hosts, headers, and paths that went through uriEncode
+    static std::wstring widen(std::string_view s) {
+        return {s.begin(), s.end()};
+    }
+
+    static std::span<const uint8_t> bytes(std::string_view s) {
+        return {reinterpret_cast<const uint8_t*>(s.data()), s.size()};
+    }
+
+    std::string signature(const std::string& stringToSign, const std::string& date) const {
+        std::optional<Digest> key = hmacSha256(bytes("AWS4" + secretKey_), bytes(date));
+        for (const std::string_view part : {std::string_view{region_}, std::string_view{"s3"}, std::string_view{"aws4_request"}}) {
+            if (key) key = hmacSha256(*key, bytes(part));
+        }
+        if (key) key = hmacSha256(*key, bytes(stringToSign));
+        return key ? toHex(*key) : std::string{};
+    }
+
+    // the signed headers, ready for WinHttpAddRequestHeaders
+    std::string signedHeaders(std::string_view method, const std::string& query, std::span<const char> body) const {
+        SYSTEMTIME now;
+        GetSystemTime(&now);
+        char amzDate[17];
+        std::snprintf(amzDate, sizeof(amzDate), "%04u%02u%02uT%02u%02u%02uZ", now.wYear, now.wMonth, now.wDay, now.wHour, now.wMinute, now.wSecond);
+        const std::string date{amzDate, 8};
+
+        const auto bodyHash = sha256({bytes({body.data(), body.size()})});
+        const std::string payloadHash = bodyHash ? toHex(*bodyHash) : "";
+
+        std::string headers = "host:" + hostHeader_ + "\n"
+            + "x-amz-content-sha256:" + payloadHash + "\n"
+            + "x-amz-date:" + amzDate + "\n";
+        std::string headerNames = "host;x-amz-content-sha256;x-amz-date";
+        if (!sessionToken_.empty()) {
+            headers += "x-amz-security-token:" + sessionToken_ + "\n";
+            headerNames += ";x-amz-security-token";
+        }
+
+        const std::string canonicalRequest = std::string{method} + "\n" + path_ + "\n" + query + "\n" + headers + "\n" + headerNames + "\n" + payloadHash;
+        const std::string scope = date + "/" + region_ + "/s3/aws4_request";
+        const auto requestHash = sha256({bytes(canonicalRequest)});
+        const std::string stringToSign = "AWS4-HMAC-SHA256\n" + std::string{amzDate} + "\n" + scope + "\n" + (requestHash ? toHex(*requestHash) : "");
+
+        std::string out = "x-amz-content-sha256: " + payloadHash + "\r\n"
+            + "x-amz-date: " + amzDate + "\r\n"
+            + "Authorization: AWS4-HMAC-SHA256 Credential=" + accessKey_ + "/" + scope
+            + ", SignedHeaders=" + headerNames + ", Signature=" + signature(stringToSign, date) + "\r\n";
+        if (!sessionToken_.empty()) out += "x-amz-security-token: " + sessionToken_ + "\r\n";
+        return out;
+    }
+public:
+    // sigv4's flavour of percent encoding: everything but unreserved characters (and, in paths, '/')
+    static std::string uriEncode(std::string_view s, bool keepSlash) {
+        static constexpr char digits[] = "0123456789ABCDEF";
+        std::string out;
+        for (char c : s) {
+            const bool unreserved = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+                || c == '-' || c == '_' || c == '.' || c == '~' || (keepSlash && c == '/');
+            if (unreserved) {
+                out.push_back(c);
+            }
+            else {
+                out.push_back('%');
+                out.push_back(digits[static_cast<uint8_t>(c) >> 4]);
+                out.push_back(digits[static_cast<uint8_t>(c) & 0xF]);
+            }
+        }
+        return out;
+    }
+
+    explicit S3Client(std::string_view url) {
+        if (url.starts_with("https://")) {
+            secure_ = true;
+            url.remove_prefix(8);
+        }
+        else if (url.starts_with("http://")) {
+            url.remove_prefix(7);
+        }
+        else {
+            setError("s3 urls look like http[s]://host[:port]/bucket/key");
+            return;
+        }
+
+        const size_t slash = url.find('/');
+        hostHeader_ = url.substr(0, slash);
+        const std::string_view objectPath = slash == std::string_view::npos ? std::string_view{} : url.substr(slash + 1);
+        if (hostHeader_.empty() || objectPath.find('/') == std::string_view::npos) {
+            setError("s3 urls look like http[s]://host[:port]/bucket/key");
+            return;
+        }
+        path_ = "/" + uriEncode(objectPath, true);
+
+        const size_t colon = hostHeader_.find(':');
+        hostName_ = hostHeader_.substr(0, colon);
+        port_ = secure_ ? INTERNET_DEFAULT_HTTPS_PORT : INTERNET_DEFAULT_HTTP_PORT;
+        if (colon != std::string::npos) {
+            const auto port = parseCount(std::string_view{hostHeader_}.substr(colon + 1));
+            if (!port || *port > 65535) {
+                setError("bad port in " + hostHeader_);
+                return;
+            }
+            port_ = static_cast<INTERNET_PORT>(*port);
+        }
+
+        accessKey_ = env("AWS_ACCESS_KEY_ID");
+        secretKey_ = env("AWS_SECRET_ACCESS_KEY");
+        sessionToken_ = env("AWS_SESSION_TOKEN");
+        region_ = env("AWS_REGION");
+        if (region_.empty()) region_ = "us-east-1";
+        if (accessKey_.empty() || secretKey_.empty()) {
+            setError("AWS_ACCESS_KEY_ID and AWS_SECRET_ACCESS_KEY need to be set for s3 uploads");
+            return;
+        }
+
+        session_ = WinHttpOpen(L"dumpsock", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
+        if (session_) connection_ = WinHttpConnect(session_, widen(hostName_).c_str(), port_, 0);
+        if (!connection_) setError("couldn't set up http to " + hostHeader_ + ": " + std::to_string(GetLastError()));
+    }
+
+    ~S3Client() {
+        if (connection_) WinHttpCloseHandle(connection_);
+        if (session_) WinHttpCloseHandle(session_);
+    }
+
+    S3Client(const S3Client&) = delete;
+    S3Client& operator=(const S3Client&) = delete;
+
+    // one attempt at a request against the object; `query` must already be canonical (sorted, encoded).
+    // nullopt if no response came back at all. safe to call from several threads at once
+    std::optional<Response> request(const char* method, const std::string& query, std::span<const char> body) const {
+        const std::string target = path_ + (query.empty() ? "" : "?" + query);
+        HINTERNET request = WinHttpOpenRequest(connection_, widen(method).c_str(), widen(target).c_str(), nullptr,
+            WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, secure_ ? WINHTTP_FLAG_SECURE : 0);
+        if (!request) return std::nullopt;
+
+        std::optional<Response> response;
+        const std::wstring headers = widen(signedHeaders(method, query, body));
+        const DWORD size = static_cast<DWORD>(body.size());
+        if (WinHttpAddRequestHeaders(request, headers.c_str(), static_cast<DWORD>(-1), WINHTTP_ADDREQ_FLAG_ADD | WINHTTP_ADDREQ_FLAG_REPLACE)
+            && WinHttpSendRequest(request, WINHTTP_NO_ADDITIONAL_HEADERS, 0, const_cast<char*>(body.data()), size, size, 0)
+            && WinHttpReceiveResponse(request, nullptr)) {
+            response.emplace();
+            DWORD statusSize = sizeof(response->status);
+            WinHttpQueryHeaders(request, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX, &response->status, &statusSize, WINHTTP_NO_HEADER_INDEX);
+
+            wchar_t etag[256];
+            DWORD etagSize = sizeof(etag);
+            if (WinHttpQueryHeaders(request, WINHTTP_QUERY_ETAG, WINHTTP_HEADER_NAME_BY_INDEX, etag, &etagSize, WINHTTP_NO_HEADER_INDEX)) {
+                for (DWORD i = 0; i < etagSize / sizeof(wchar_t); i++) response->etag.push_back(static_cast<char>(etag[i]));
+            }
+
+            DWORD available = 0;
+            while (WinHttpQueryDataAvailable(request, &available) && available > 0) {
+                const size_t start = response->body.size();
+                response->body.resize(start + available);
+                DWORD read = 0;
+                if (!WinHttpReadData(request, response->body.data() + start, available, &read)) break;
+                response->body.resize(start + read);
+            }
+        }
+        WinHttpCloseHandle(request);
+        return response;
+    }
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+// uploads the stream straight into an s3-compatible object store as a multipart upload while it's being received.
+// parts are uploaded from the pool, a few at a time, each retried with backoff; a transfer that fails aborts the upload
+class S3Sink : public Sink {
+private:
+    static constexpr size_t partSize = 1024 * 1024 * 8; // 8MiB; s3 wants at least 5MiB for all but the last part
+    static constexpr size_t maxPartsInFlight = 4;
+    static constexpr int maxAttempts = 5;
+
+    ThreadPool& pool_;
+    S3Client client_;
+    std::string uploadId_;
+    Chunk part_;
+    int nextPart_ = 1;
+
+    std::mutex mutex_;
+    std::condition_variable partDone_;
+    size_t inFlight_ = 0;
+    std::map<int, std::string> etags_;
+    std::optional<std::string> partError_;
+
+    static std::string xmlValue(const std::string& xml, const std::string& tag) {
+        const size_t start = xml.find("<" + tag + ">");
+        const size_t end = xml.find("</" + tag + ">");
+        if (start == std::string::npos || end == std::string::npos) return {};
+        const size_t from = start + tag.size() + 2;
+        return end > from ? xml.substr(from, end - from) : std::string{};
+    }
+
+    static std::string describe(const std::optional<S3Client::Response>& response) {
+        if (!response) return "no response: " + std::to_string(GetLastError());
+        const std::string code = xmlValue(response->body, "Code");
+        return "http " + std::to_string(response->status) + (code.empty() ? "" : " " + code);
+    }
+
+    // transport failures, timeouts, throttling and server errors are worth another go; anything else isn't
+    std::optional<S3Client::Response> requestWithRetry(const char* method, const std::string& query, std::span<const char> body) const {
+        for (int attempt = 0;; attempt++) {
+            auto response = client_.request(method, query, body);
+            const bool retry = !response || response->status >= 500 || response->status == 408 || response->status == 429;
+            if (!retry || attempt + 1 == maxAttempts) return response;
+            Sleep(100u << attempt);
+        }
+    }
+
+    void waitForParts(size_t atMost) {
+        std::unique_lock lock{mutex_};
+        partDone_.wait(lock, [&] { return inFlight_ <= atMost; });
+        if (partError_ && !error()) setError(*partError_);
+    }
+
+    void uploadPart() {
+        waitForParts(maxPartsInFlight - 1);
+        if (error()) return;
+
+        const int number = nextPart_++;
+        {
+            std::lock_guard lock{mutex_};
+            inFlight_++;
+        }
+        pool_.submit([this, number, body = std::move(part_)] {
+            const std::string query = "partNumber=" + std::to_string(number) + "&uploadId=" + S3Client::uriEncode(uploadId_, false);
+            const auto response = requestWithRetry("PUT", query, body);
+
+            std::lock_guard lock{mutex_};
+            if (response && response->status == 200 && !response->etag.empty()) {
+                etags_[number] = response->etag;
+            }
+            else if (!partError_) {
+                partError_ = "upload of part " + std::to_string(number) + " failed: " + describe(response);
+            }
+            inFlight_--;
+            partDone_.notify_all();
+        });
+        part_ = Chunk{};
+        part_.reserve(partSize);
+    }
+public:
+    S3Sink(std::string_view url, ThreadPool& pool) : pool_(pool), client_(url) {
+        if (client_.error()) {
+            setError(*client_.error());
+            return;
+        }
+        const auto response = requestWithRetry("POST", "uploads=", {});
+        uploadId_ = response && response->status == 200 ? xmlValue(response->body, "UploadId") : "";
+        if (uploadId_.empty()) {
+            setError("couldn't start a multipart upload: " + describe(response));
+            return;
+        }
+        part_.reserve(partSize);
+    }
+
+    ~S3Sink() {
+        waitForParts(0);
+    }
+
+    void write(std::span<const char> data) override {
+        if (error()) return;
+        while (!data.empty()) {
+            const size_t take = std::min(data.size(), partSize - part_.size());
+            part_.insert(part_.end(), data.begin(), data.begin() + take);
+            data = data.subspan(take);
+            if (part_.size() == partSize) uploadPart();
+        }
+    }
+
+    void commit() override {
+        if (error()) return;
+        if (!part_.empty() || nextPart_ == 1) uploadPart();
+        waitForParts(0);
+        if (error()) {
+            abort();
+            return;
+        }
+
+        std::string complete = "<CompleteMultipartUpload>";
+        for (const auto& [number, etag] : etags_) {
+            complete += "<Part><PartNumber>" + std::to_string(number) + "</PartNumber><ETag>" + etag + "</ETag></Part>";
+        }
+        complete += "</CompleteMultipartUpload>";
+
+        // s3 can answer 200 and still put an error in the body
+        const auto response = requestWithRetry("POST", "uploadId=" + S3Client::uriEncode(uploadId_, false), complete);
+        if (!response || response->status != 200 || response->body.find("<Error>") != std::string::npos) {
+            setError("couldn't complete the multipart upload: " + describe(response));
+            abort();
+        }
+    }
+
+    void abort() override {
+        waitForParts(0);
+        if (uploadId_.empty()) return;
+        requestWithRetry("DELETE", "uploadId=" + S3Client::uriEncode(uploadId_, false), {});
+        uploadId_.clear();
+    }
+};
+
+// sink specs: "stdout" (the default), ec:K:M:DIR,DIR,... with one directory per shard,
+// or s3:http[s]://host[:port]/bucket/key
+std::unique_ptr<Sink> makeSink(std::string_view spec, ThreadPool& pool) {
+    if (spec == "stdout") return std::make_unique<StdoutSink>();
+
+    if (spec.starts_with("ec:")) {
+        const size_t kEnd = spec.find(':', 3);
+        const size_t mEnd = kEnd == std::string_view::npos ? kEnd : spec.find(':', kEnd + 1);
+        if (mEnd == std::string_view::npos) return nullptr;
+        const auto k = parseCount(spec.substr(3, kEnd - 3));
+        const auto m = parseCount(spec.substr(kEnd + 1, mEnd - kEnd - 1));
+        if (!k || !m) return nullptr;
+
+        std::vector<std::string> dirs;
+        for (std::string_view rest = spec.substr(mEnd + 1); !rest.empty();) {
+            const size_t comma = rest.find(',');
+            dirs.emplace_back(rest.substr(0, comma));
+            rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+        }
+        return std::make_unique<ErasureSink>(*k, *m, dirs, pool);
+    }
+    if (spec.starts_with("s3:")) return std::make_unique<S3Sink>(spec.substr(3), pool);
+    return nullptr;
+}
+
+// chains stages between the receive loop and a sink
+// each stage (and the sink) gets its own task on the shared pool, and hands its output to the next one over a BoundedQueue
+class Pipeline {
+private:
+    struct StageMetrics {
+        uint64_t chunks = 0;
+        uint64_t bytesIn = 0;
+        uint64_t bytesOut = 0;
+        std::chrono::high_resolution_clock::duration busy{};
+        Histogram latency; // ns per chunk, or per block for block stages
+    };
+
+    static constexpr size_t queueCapacity = 64; // chunks
+
+    ThreadPool& pool_;
+    Sink& sink_;
+    std::vector<std::unique_ptr<Stage>> stages_;
+    std::vector<StageMetrics> metrics_;
+    // queues_[i] feeds stages_[i], the last one feeds the sink
+    std::vector<std::unique_ptr<BoundedQueue<Chunk>>> queues_;
+    std::optional<std::latch> done_;
+    std::chrono::high_resolution_clock::time_point start_;
+    std::chrono::high_resolution_clock::time_point end_;
+    Histogram writeLatency_; // ns per sink write
+    std::atomic<size_t> blocksInFlight_; // cap on blocks handed to the pool and not yet passed on, per block stage
+
+    void runSerialStage(size_t i, Stage& stage) {
+        StageMetrics& metrics = metrics_[i];
+        BoundedQueue<Chunk>& in = *queues_[i];
+        BoundedQueue<Chunk>& next = *queues_[i + 1];
+
+        while (auto chunk = in.pop()) {
+            // keep draining after an error so nothing upstream blocks on a full queue
+            if (stage.error()) continue;
+
+            stage.observeBacklog(static_cast<double>(in.depth()) / in.capacity());
+            Chunk out;
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            stage.process(*chunk, out);
+            const auto t1 = std::chrono::high_resolution_clock::now();
+            metrics.busy += t1 - t0;
+            metrics.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+            TraceLoggingWrite(traceProvider, "StageChunk",
+                TraceLoggingString(stage.name(), "Stage"),
+                TraceLoggingUInt64(chunk->size(), "BytesIn"),
+                TraceLoggingUInt64(out.size(), "BytesOut"),
+                TraceLoggingUInt64(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count(), "Microseconds"));
+            timeline.record(stage.name(), "stage", t0, t1, chunk->size());
+            metrics.chunks++;
+            metrics.bytesIn += chunk->size();
+            metrics.bytesOut += out.size();
+            if (!out.empty()) next.push(std::move(out));
+        }
+
+        if (!stage.error()) {
+            Chunk out;
+            stage.finish(out);
+            metrics.bytesOut += out.size();
+            if (!out.empty()) next.push(std::move(out));
+        }
+    }
+
+    // cuts the stream into the stage's blocks and fans them out over the pool
+    // blocks finish in any order and are reassembled in stream order before going downstream;
+    // no more than maxBlocksInFlight() are out at once so a slow sink still pushes back on the receive loop
+    void runBlockStage(size_t i, BlockStage& stage) {
+        struct FinishedBlock {
+            Chunk out;
+            size_t inSize;
+        };
+
+        StageMetrics& metrics = metrics_[i];
+        BoundedQueue<Chunk>& in = *queues_[i];
+        BoundedQueue<Chunk>& next = *queues_[i + 1];
+        const size_t blockSize = stage.blockSize();
+
+        std::mutex mutex;
+        std::condition_variable blockFinished;
+        std::map<uint64_t, FinishedBlock> finished;
+        std::vector<Histogram> workerLatency(pool_.threadCount()); // merged into metrics.latency once every block is in
+        uint64_t submitted = 0;
+        uint64_t emitted = 0;
+
+        // hands on every block that's next in line; with `wait`, first blocks until there is one
+        auto emitReady = [&](bool wait) {
+            std::unique_lock lock{mutex};
+            if (wait) blockFinished.wait(lock, [&] { return finished.contains(emitted); });
+            for (auto it = finished.find(emitted); it != finished.end(); it = finished.find(emitted)) {
+                FinishedBlock block = std::move(it->second);
+                finished.erase(it);
+                lock.unlock();
+                stage.blockDone(emitted, block.inSize, block.out);
+                metrics.bytesOut += block.out.size();
+                if (!block.out.empty()) next.push(std::move(block.out));
+                emitted++;
+                lock.lock();
+            }
+        };
+
+        auto submit = [&](Chunk block) {
+            stage.observeBacklog(static_cast<double>(in.depth()) / in.capacity());
+            while (submitted - emitted >= maxBlocksInFlight()) emitReady(true);
+            const uint64_t index = submitted++;
+            pool_.submit([&, index, block = std::move(block)] {
+                Chunk out;
+                const auto t0 = std::chrono::high_resolution_clock::now();
+                stage.transformBlock(index, block, out);
+                const auto t1 = std::chrono::high_resolution_clock::now();
+                const auto elapsed = t1 - t0;
+                workerLatency[pool_.workerIndex()].record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+                timeline.record(stage.name(), "block", t0, t1, block.size());
+                TraceLoggingWrite(traceProvider, "StageBlock",
+                    TraceLoggingString(stage.name(), "Stage"),
+                    TraceLoggingUInt64(index, "Index"),
+                    TraceLoggingUInt64(block.size(), "BytesIn"),
+                    TraceLoggingUInt64(out.size(), "BytesOut"),
+                    TraceLoggingUInt64(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(), "Microseconds"));
+
+                std::lock_guard lock{mutex};
+                metrics.busy += elapsed;
+                finished.emplace(index, FinishedBlock{std::move(out), block.size()});
+                blockFinished.notify_one();
+            });
+            emitReady(false);
+        };
+
+        Chunk pending;
+        pending.reserve(blockSize);
+        while (auto chunk = in.pop()) {
+            if (stage.error()) continue;
+
+            metrics.chunks++;
+            metrics.bytesIn += chunk->size();
+            std::span<const char> rest = *chunk;
+            while (!rest.empty()) {
+                const size_t take = std::min(rest.size(), blockSize - pending.size());
+                pending.insert(pending.end(), rest.begin(), rest.begin() + take);
+                rest = rest.subspan(take);
+                if (pending.size() == blockSize) {
+                    submit(std::move(pending));
+                    pending = Chunk{};
+                    pending.reserve(blockSize);
+                }
+            }
+        }
+        if (!pending.empty() && !stage.error()) submit(std::move(pending));
+        while (emitted < submitted) emitReady(true);
+        for (const Histogram& h : workerLatency) metrics.latency.merge(h);
+
+        if (!stage.error()) {
+            Chunk out;
+            stage.finish(out);
+            metrics.bytesOut += out.size();
+            if (!out.empty()) next.push(std::move(out));
+        }
+    }
+
+    void runStage(size_t i) {
+        if (auto* blockStage = dynamic_cast<BlockStage*>(stages_[i].get())) {
+            runBlockStage(i, *blockStage);
+        }
+        else {
+            runSerialStage(i, *stages_[i]);
+        }
+        queues_[i + 1]->close();
+        done_->count_down();
+    }
+
+    size_t maxBlocksInFlight() const {
+        return blocksInFlight_.load(std::memory_order_relaxed);
+    }
+
+    void runSink() {
+        while (auto chunk = queues_.back()->pop()) {
+            if (sink_.error()) continue;
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            sink_.write(*chunk);
+            const auto t1 = std::chrono::high_resolution_clock::now();
+            writeLatency_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+            TraceLoggingWrite(traceProvider, "SinkWrite",
+                TraceLoggingUInt64(chunk->size(), "Bytes"),
+                TraceLoggingUInt64(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count(), "Microseconds"));
+            timeline.record("write", "sink", t0, t1, chunk->size());
+        }
+        done_->count_down();
+    }
+public:
+    Pipeline(ThreadPool& pool, Sink& sink) : pool_(pool), sink_(sink), blocksInFlight_(2 * pool.threadCount()) {}
+
+    // how many pool threads start() ties up for the whole transfer; block stages need workers on top of these
+    static size_t threadsNeeded(size_t stageCount) {
+        return stageCount + 1;
+    }
+
+    void addStage(std::unique_ptr<Stage> stage) {
+        stages_.push_back(std::move(stage));
+    }
+
+    void start() {
+        metrics_.resize(stages_.size());
+        for (size_t i = 0; i <= stages_.size(); i++) {
+            queues_.push_back(std::make_unique<BoundedQueue<Chunk>>(queueCapacity));
+        }
+        done_.emplace(static_cast<ptrdiff_t>(stages_.size() + 1));
+        start_ = std::chrono::high_resolution_clock::now();
+
+        for (size_t i = 0; i < stages_.size(); i++) {
+            pool_.submit([this, i] { runStage(i); });
+        }
+        pool_.submit([this] { runSink(); });
+    }
+
+    // blocks while the first stage is backed up
+    void push(Chunk chunk) {
+        queues_.front()->push(std::move(chunk));
+    }
+
+    // no more input; waits for every stage to flush through to the sink
+    void finish() {
+        queues_.front()->close();
+        done_->wait();
+        end_ = std::chrono::high_resolution_clock::now();
+    }
+
+    Sink& sink() { return sink_; }
+
+    // what the auto tuner may move inside the pipeline: each stage's own knob, and with any block stage, how many
+    // blocks may be out on the pool at once, which caps how many workers they keep busy
+    std::vector<TuningKnob> tuningKnobs() {
+        std::vector<TuningKnob> knobs;
+        bool blockStages = false;
+        for (auto& stage : stages_) {
+            if (auto knob = stage->tuningKnob()) knobs.push_back(std::move(*knob));
+            if (dynamic_cast<BlockStage*>(stage.get())) blockStages = true;
+        }
+        if (blockStages) {
+            TuningKnob knob{"blocks in flight"};
+            for (size_t n = 1; n < blocksInFlight_; n *= 2) knob.values.push_back(n);
+            knob.values.push_back(blocksInFlight_);
+            knob.at = knob.values.size() - 1;
+            knob.apply = [this](size_t n) { blocksInFlight_ = n; };
+            knobs.push_back(std::move(knob));
+        }
+        return knobs;
+    }
+
+    std::optional<std::string> error() const {
+        for (const auto& stage : stages_) {
+            if (stage->error()) return std::string{stage->name()} + ": " + *stage->error();
+        }
+        return sink_.error();
+    }
+
+    // per stage throughput while busy, share of wall time spent busy, and how deep its input queue got;
+    // the bottleneck is the stage that's busy close to 100% of the time with a full queue in front of it.
+    // block stages add up busy time across workers, so they can go past 100%.
+    // averages hide the tail, so each stage and the sink writes also get latency percentiles
+    void report(std::ostream& os) {
+        const double wall = std::chrono::duration<double>(end_ - start_).count();
+        for (size_t i = 0; i < stages_.size(); i++) {
+            const StageMetrics& m = metrics_[i];
+            const double busy = std::chrono::duration<double>(m.busy).count();
+            const double MiBps = busy > 0 ? m.bytesIn / busy / 1024 / 1024 : 0;
+            os << "  stage " << stages_[i]->name() << ": "
+               << m.bytesIn << " -> " << m.bytesOut << " bytes, "
+               << MiBps << " MiB/s busy, "
+               << (wall > 0 ? busy / wall * 100 : 0) << "% of wall, "
+               << "queue max " << queues_[i]->maxDepth() << "/" << queues_[i]->capacity();
+            const std::string summary = stages_[i]->summary();
+            if (!summary.empty()) os << ", " << summary;
+            os << std::endl;
+            os << "    " << (dynamic_cast<BlockStage*>(stages_[i].get()) ? "per block " : "per chunk ");
+            m.latency.describe(os, 1000, "us");
+            os << std::endl;
+        }
+        os << "  sink queue max " << queues_.back()->maxDepth() << "/" << queues_.back()->capacity() << ", write ";
+        writeLatency_.describe(os, 1000, "us");
+        os << std::endl;
+    }
+};
+
+// polls SIO_TCP_INFO on the data socket from its own thread while the transfer runs, to tell a receiver limited
+// transfer (our advertised window keeps closing because the pipeline can't drain the socket fast enough) from one that's
+// limited by the sender or the network (the window stays open and the rtt and reordering say why)
+class TcpInfoSampler {
+private:
+    SOCKET socket_ = INVALID_SOCKET;
+    std::chrono::milliseconds interval_{};
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+
+    Histogram rttUs_;
+    Histogram rcvWnd_;
+    uint64_t windowClosed_ = 0; // samples where less than two segments' worth of window was left
+    std::optional<TCP_INFO_v0> last_;
+    std::optional<std::string> error_;
+
+    void sample() {
+        DWORD version = 0;
+        TCP_INFO_v0 info{};
+        DWORD returned = 0;
+        if (WSAIoctl(socket_, SIO_TCP_INFO, &version, sizeof(version), &info, sizeof(info), &returned, NULL, NULL) == SOCKET_ERROR) {
+            error_ = "SIO_TCP_INFO failed: " + std::to_string(WSAGetLastError());
+            return;
+        }
+        rttUs_.record(info.RttUs);
+        rcvWnd_.record(info.RcvWnd);
+        if (info.RcvWnd < 2 * info.Mss) windowClosed_++;
+        last_ = info;
+    }
+
+    void run() {
+        std::unique_lock lock{mutex_};
+        while (!error_) {
+            sample();
+            if (wake_.wait_for(lock, interval_, [&] { return stopping_; })) break;
+        }
+    }
+public:
+    ~TcpInfoSampler() {
+        stop();
+    }
+
+    void start(SOCKET socket, std::chrono::milliseconds interval) {
+        socket_ = socket;
+        interval_ = interval;
+        thread_ = std::thread([this] { run(); });
+    }
+
+    // takes one last sample so the cumulative counters cover the whole transfer
+    void stop() {
+        if (!thread_.joinable()) return;
+        {
+            std::lock_guard lock{mutex_};
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        thread_.join();
+        if (!error_) sample();
+    }
+
+    void report(std::ostream& os) const {
+        if (error_) {
+            os << "  tcp info: " << *error_ << std::endl;
+            return;
+        }
+        if (!last_) return;
+
+        const TCP_INFO_v0& info = *last_;
+        const uint64_t samples = rttUs_.count();
+        os << "  tcp rtt ";
+        rttUs_.describe(os, 1000, "ms");
+        os << ", min " << info.MinRttUs / 1000.0 << "ms" << std::endl;
+        os << "  tcp receive window ";
+        rcvWnd_.describe(os, 1024, "KiB");
+        os << ", buffer " << info.RcvBuf / 1024 << "KiB, mss " << info.Mss << std::endl;
+        os << "  tcp " << info.BytesIn << " bytes in, " << info.BytesReordered << " reordered; "
+           << "send side cwnd " << info.Cwnd << ", " << info.BytesRetrans << " bytes retransmitted, "
+           << info.FastRetrans << " fast retransmits, " << info.TimeoutEpisodes << " timeouts" << std::endl;
+
+        const double closed = samples ? 100.0 * windowClosed_ / samples : 0;
+        os << "  receive window nearly closed in " << closed << "% of " << samples << " samples: "
+           << (closed >= 10 ? "receiver limited, the pipeline isn't draining the socket fast enough"
+                            : "not receiver limited, look at the sender and the network") << std::endl;
+    }
+};
+
+// kernel receive timestamps (SIO_TIMESTAMPING, windows 10 2004 and up): the stack stamps what it receives with the
+// qpc value at arrival, and the gap between that and WSARecvMsg returning it is the delivery latency the receive path
+// adds. windows only stamps datagram sockets, so this is for the rudp reader
+class RxTimestamps {
+private:
+    double ticksPerNs_ = 0;
+    Histogram latencyNs_;
+    uint64_t receives_ = 0;
+    std::optional<std::string> error_;
+public:
+    void enable(SOCKET socket) {
+        TIMESTAMPING_CONFIG config{};
+        config.Flags = TIMESTAMPING_FLAG_RX;
+        DWORD returned = 0;
+        if (WSAIoctl(socket, SIO_TIMESTAMPING, &config, sizeof(config), NULL, 0, &returned, NULL, NULL) == SOCKET_ERROR) {
+            error_ = "SIO_TIMESTAMPING failed: " + std::to_string(WSAGetLastError());
+            return;
+        }
+
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        ticksPerNs_ = frequency.QuadPart / 1e9;
+    }
+
+    // picks the arrival stamp out of what a WSARecvMsg just returned, which needs controlSize bytes of control buffer
+    static constexpr size_t controlSize = WSA_CMSG_SPACE(sizeof(uint64_t));
+    void record(WSAMSG& msg) {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        receives_++;
+        for (WSACMSGHDR* c = WSA_CMSG_FIRSTHDR(&msg); c; c = WSA_CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SO_TIMESTAMP) continue;
+            uint64_t arrived;
+            std::memcpy(&arrived, WSA_CMSG_DATA(c), sizeof(arrived));
+            if (static_cast<uint64_t>(now.QuadPart) >= arrived) latencyNs_.record(static_cast<uint64_t>((now.QuadPart - arrived) / ticksPerNs_));
+        }
+    }
+
+    const std::optional<std::string>& error() const { return error_; }
+
+    void report(std::ostream& os) const {
+        if (receives_ == 0) return;
+        os << "  kernel to user " << latencyNs_.count() << " of " << receives_ << " receives stamped, ";
+        latencyNs_.describe(os, 1000, "us");
+        os << std::endl;
+    }
+};
+
+// how the receive loop pulls bytes off the socket; not to be confused with ReceiveEngine, which is how --serve
+// spreads connections over threads
+enum class ReadEngine { recv, overlapped, rio };
+
+constexpr std::array<ReadEngine, 3> readEngines = {ReadEngine::recv, ReadEngine::overlapped, ReadEngine::rio};
+
+std::optional<ReadEngine> readEngineForName(std::string_view name) {
+    if (name == "recv") return ReadEngine::recv;
+    if (name == "overlapped") return ReadEngine::overlapped;
+    if (name == "rio") return ReadEngine::rio;
+    return std::nullopt;
+}
+
+const char* readEngineName(ReadEngine engine) {
+    switch (engine) {
+        case ReadEngine::overlapped: return "overlapped";
+        case ReadEngine::rio: return "rio";
+        default: return "recv";
+    }
+}
+
+// recv keeps to the 4KiB it always read; the engines that keep several receives posted want room in each
+size_t defaultReadSize(ReadEngine engine) {
+    return engine == ReadEngine::recv ? 4096 : 64 * 1024;
+}
+
+// a tcp socket every engine can read from; registered i/o has to be asked for when the socket is created, and
+// sockets accepted from it inherit it
+SOCKET readEngineSocket(bool registeredIo) {
+    return registeredIo
+        ? WSASocketW(AF_INET, SOCK_STREAM, IPPROTO_TCP, NULL, 0, WSA_FLAG_OVERLAPPED | WSA_FLAG_REGISTERED_IO)
+        : socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+}
+
+// one way of reading a connected socket. read() blocks until something arrives and hands back a view of it that
+// stays valid until the next read(); an empty view is the end of the stream, or a failure if error() is set.
+// the socket has to be closed before the reader goes, which cancels anything it still has posted
+class SocketReader {
+private:
+    std::optional<std::string> error_;
+protected:
+    void setError(std::string msg) {
+        if (!error_) error_ = std::move(msg);
+    }
+public:
+    virtual ~SocketReader() = default;
+
+    virtual std::span<const char> read(size_t max) = 0;
+
+    // for falling back to another engine: stops reading, with nothing left posted on the socket once it returns, and
+    // hands back whatever the posted receives had already taken off it, in order
+    virtual Chunk abandon() { return {}; }
+
+    // anything worth reporting after the transfer, one line, no newline
+    virtual std::string summary() const { return {}; }
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+class RecvReader : public SocketReader {
+private:
+    SOCKET socket_;
+    std::vector<char> buffer_;
+public:
+    RecvReader(SOCKET socket, size_t bufferSize) : socket_(socket), buffer_(bufferSize) {}
+
+    std::span<const char> read(size_t max) override {
+        const int result = recv(socket_, buffer_.data(), static_cast<int>(std::min(max, buffer_.size())), 0);
+        if (result == SOCKET_ERROR) {
+            setError("socket error during read");
+            return {};
+        }
+        return {buffer_.data(), static_cast<size_t>(result)};
+    }
+};
+
+// keeps slotCount overlapped WSARecvs posted, so the stack always has somewhere to put data while the last buffer is
+// being handed on. a stream socket fills them in the order they were posted, so they're reaped round robin
+class OverlappedReader : public SocketReader {
+private:
+    static constexpr size_t slotCount = 8;
+
+    struct Slot {
+        WSAOVERLAPPED overlapped{};
+        std::vector<char> buffer;
+        bool posted = false;
+    };
+
+    SOCKET socket_;
+    std::array<Slot, slotCount> slots_;
+    size_t next_ = 0;
+    std::optional<size_t> handedOut_; // goes back to the stack on the next read()
+    bool ended_ = false;
+
+    void post(Slot& slot, size_t max) {
+        const HANDLE event = slot.overlapped.hEvent;
+        slot.overlapped = {};
+        slot.overlapped.hEvent = event;
+        ResetEvent(event);
+        WSABUF buf{static_cast<ULONG>(std::min(max, slot.buffer.size())), slot.buffer.data()};
+        DWORD flags = 0;
+        if (WSARecv(socket_, &buf, 1, NULL, &flags, &slot.overlapped, NULL) == SOCKET_ERROR && WSAGetLastError() != WSA_IO_PENDING) {
+            setError("WSARecv failed: " + std::to_string(WSAGetLastError()));
+            return;
+        }
+        slot.posted = true;
+    }
+public:
+    OverlappedReader(SOCKET socket, size_t bufferSize) : socket_(socket) {
+        for (Slot& slot : slots_) {
+            slot.buffer.resize(bufferSize);
+            slot.overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+            if (!slot.overlapped.hEvent) {
+                setError("CreateEvent failed: " + std::to_string(GetLastError()));
+                return;
+            }
+        }
+        for (Slot& slot : slots_) {
+            post(slot, bufferSize);
+            if (error()) return;
+        }
+    }
+
+    ~OverlappedReader() {
+        CancelIoEx(reinterpret_cast<HANDLE>(socket_), NULL);
+        for (Slot& slot : slots_) {
+            if (slot.posted) WaitForSingleObject(slot.overlapped.hEvent, INFINITE);
+            if (slot.overlapped.hEvent) CloseHandle(slot.overlapped.hEvent);
+        }
+    }
+
+    std::span<const char> read(size_t max) override {
+        if (ended_ || error()) return {};
+        if (handedOut_) {
+            post(slots_[*handedOut_], max);
+            handedOut_.reset();
+            if (error()) return {};
+        }
+
+        Slot& slot = slots_[next_];
+        DWORD received = 0;
+        DWORD flags = 0;
+        const BOOL ok = WSAGetOverlappedResult(socket_, &slot.overlapped, &received, TRUE, &flags);
+        slot.posted = false;
+        if (!ok) {
+            setError("WSARecv failed: " + std::to_string(WSAGetLastError()));
+            return {};
+        }
+        if (received == 0) {
+            ended_ = true;
+            return {};
+        }
+        handedOut_ = next_;
+        next_ = (next_ + 1) % slotCount;
+        return {slot.buffer.data(), received};
+    }
+
+    Chunk abandon() override {
+        CancelIoEx(reinterpret_cast<HANDLE>(socket_), NULL);
+        Chunk received;
+        bool more = !ended_;
+        for (size_t i = 0; i < slotCount; i++) {
+            Slot& slot = slots_[(next_ + i) % slotCount];
+            if (!slot.posted) continue;
+            DWORD bytes = 0;
+            DWORD flags = 0;
+            const BOOL ok = WSAGetOverlappedResult(socket_, &slot.overlapped, &bytes, TRUE, &flags);
+            slot.posted = false;
+            // once one was cancelled, or saw the end, the ones after it can't have anything
+            if (!ok || bytes == 0) more = false;
+            if (more) received.insert(received.end(), slot.buffer.data(), slot.buffer.data() + bytes);
+        }
+        return received;
+    }
+};
+
+// registered i/o: the buffers are registered with the stack once up front, and receives are posted and reaped
+// through queues shared with it, which skips the per call buffer locking and most of the system calls. only works on
+// a socket from readEngineSocket(true). completions are picked up by slot so they come back in the order posted
+class RioReader : public SocketReader {
+private:
+    static constexpr ULONG slotCount = 8;
+
+    RIO_EXTENSION_FUNCTION_TABLE rio_{};
+    size_t slotSize_;
+    char* buffer_ = nullptr;
+    RIO_BUFFERID bufferId_ = RIO_INVALID_BUFFERID;
+    HANDLE completed_ = NULL;
+    RIO_CQ queue_ = RIO_INVALID_CQ;
+    RIO_RQ requests_ = RIO_INVALID_RQ;
+    std::array<std::optional<RIORESULT>, slotCount> done_; // completions not handed out yet, by slot
+    std::array<bool, slotCount> posted_{};                 // with the stack, not completed yet
+    ULONG next_ = 0;
+    std::optional<ULONG> handedOut_;
+    bool ended_ = false;
+
+    void post(ULONG slot, size_t max) {
+        RIO_BUF buf{bufferId_, static_cast<ULONG>(slot * slotSize_), static_cast<ULONG>(std::min(max, slotSize_))};
+        if (!rio_.RIOReceive(requests_, &buf, 1, 0, reinterpret_cast<PVOID>(static_cast<ULONG_PTR>(slot)))) {
+            setError("RIOReceive failed: " + std::to_string(WSAGetLastError()));
+            return;
+        }
+        posted_[slot] = true;
+    }
+
+    // waits for `slot`'s receive to complete; false if the completion queue broke
+    bool reap(ULONG slot) {
+        while (!done_[slot]) {
+            std::array<RIORESULT, slotCount> results;
+            const ULONG count = rio_.RIODequeueCompletion(queue_, results.data(), slotCount);
+            if (count == RIO_CORRUPT_CQ) return false;
+            // RIONotify on a queue that already has something in it signals straight away, so nothing is missed
+            if (count == 0) {
+                rio_.RIONotify(queue_);
+                WaitForSingleObject(completed_, INFINITE);
+            }
+            for (ULONG i = 0; i < count; i++) {
+                done_[results[i].RequestContext] = results[i];
+                posted_[results[i].RequestContext] = false;
+            }
+        }
+        return true;
+    }
+public:
+    RioReader(SOCKET socket, size_t bufferSize) : slotSize_(bufferSize) {
+        GUID rioId = WSAID_MULTIPLE_RIO;
+        DWORD returned = 0;
+        rio_.cbSize = sizeof(rio_);
+        if (WSAIoctl(socket, SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER, &rioId, sizeof(rioId),
+                     &rio_, sizeof(rio_), &returned, NULL, NULL) == SOCKET_ERROR) {
+            setError("no registered i/o: " + std::to_string(WSAGetLastError()));
+            return;
+        }
+
+        buffer_ = static_cast<char*>(VirtualAlloc(NULL, slotCount * slotSize_, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+        if (!buffer_) {
+            setError("VirtualAlloc failed: " + std::to_string(GetLastError()));
+            return;
+        }
+        bufferId_ = rio_.RIORegisterBuffer(buffer_, static_cast<DWORD>(slotCount * slotSize_));
+        if (bufferId_ == RIO_INVALID_BUFFERID) {
+            setError("RIORegisterBuffer failed: " + std::to_string(WSAGetLastError()));
+            return;
+        }
+
+        completed_ = CreateEventA(NULL, FALSE, FALSE, NULL);
+        RIO_NOTIFICATION_COMPLETION notify{};
+        notify.Type = RIO_EVENT_COMPLETION;
+        notify.Event.EventHandle = completed_;
+        notify.Event.NotifyReset = TRUE;
+        // one spare entry for the send side, which the request queue insists on having
+        queue_ = rio_.RIOCreateCompletionQueue(slotCount + 1, &notify);
+        if (queue_ == RIO_INVALID_CQ) {
+            setError("RIOCreateCompletionQueue failed: " + std::to_string(WSAGetLastError()));
+            return;
+        }
+        requests_ = rio_.RIOCreateRequestQueue(socket, slotCount, 1, 1, 1, queue_, queue_, NULL);
+        if (requests_ == RIO_INVALID_RQ) {
+            setError("RIOCreateRequestQueue failed: " + std::to_string(WSAGetLastError()));
+            return;
+        }
+        for (ULONG slot = 0; slot < slotCount && !error(); slot++) post(slot, slotSize_);
+    }
+
+    // the request queue goes with the socket, which is closed by now
+    ~RioReader() {
+        if (queue_ != RIO_INVALID_CQ) rio_.RIOCloseCompletionQueue(queue_);
+        if (bufferId_ != RIO_INVALID_BUFFERID) rio_.RIODeregisterBuffer(bufferId_);
+        if (completed_) CloseHandle(completed_);
+        if (buffer_) VirtualFree(buffer_, 0, MEM_RELEASE);
+    }
+
+    std::span<const char> read(size_t max) override {
+        if (ended_ || error()) return {};
+        if (handedOut_) {
+            post(*handedOut_, max);
+            handedOut_.reset();
+            if (error()) return {};
+        }
+
+        if (!reap(next_)) {
+            setError("registered i/o completion queue is corrupt");
+            return {};
+        }
+
+        const RIORESULT result = *done_[next_];
+        done_[next_].reset();
+        if (result.Status != 0) {
+            setError("RIOReceive failed: " + std::to_string(result.Status));
+            return {};
+        }
+        if (result.BytesTransferred == 0) {
+            ended_ = true;
+            return {};
+        }
+        const char* data = buffer_ + next_ * slotSize_;
+        handedOut_ = next_;
+        next_ = (next_ + 1) % slotCount;
+        return {data, result.BytesTransferred};
+    }
+
+    // a registered receive can't be cancelled short of closing the socket, so this waits out the posted ones, which
+    // complete as soon as the sender's next bytes (or the end of the stream) arrive
+    Chunk abandon() override {
+        Chunk received;
+        bool more = !ended_;
+        for (ULONG i = 0; i < slotCount; i++) {
+            const ULONG slot = (next_ + i) % slotCount;
+            if (!posted_[slot] && !done_[slot]) continue;
+            if (!reap(slot)) break;
+            const RIORESULT result = *done_[slot];
+            done_[slot].reset();
+            if (result.Status != 0 || result.BytesTransferred == 0) more = false;
+            if (more) received.insert(received.end(), buffer_ + slot * slotSize_, buffer_ + slot * slotSize_ + result.BytesTransferred);
+        }
+        return received;
+    }
+};
+
+std::unique_ptr<SocketReader> makeSocketReader(ReadEngine engine, SOCKET socket, size_t bufferSize) {
+    switch (engine) {
+        case ReadEngine::overlapped: return std::make_unique<OverlappedReader>(socket, bufferSize);
+        case ReadEngine::rio: return std::make_unique<RioReader>(socket, bufferSize);
+        default: return std::make_unique<RecvReader>(socket, bufferSize);
+    }
+}
+
+// a reliable stream over udp, for long fat links where tcp's congestion control leaves most of the pipe empty. the
+// sender paces datagrams at a rate it steers from the receiver's feedback instead of growing a window, so a lost
+// packet costs a retransmit rather than half the throughput. every datagram starts with a type byte:
+//   data    u8 1, u8 flags (1 = last, 2 = one way), u64 packet number, u64 sender's clock in us, payload
+//   ack     u8 2, u8 range count, u64 cumulative (every packet before it has arrived), u64 newest sender clock seen,
+//           u64 delivery rate in bytes/s since the last ack, then ranges u64 first, u64 end that arrived past the gap
+//   nak     u8 3, u8 range count, then ranges u64 first, u64 end that went missing
+//   parity  u8 4, u8 flags (1 = the group ends the stream), u64 first packet of the group, u8 packets in the group,
+//           u8 parity index, u16 length of the group's last packet, then payloadSize bytes of reed-solomon parity
+// every data packet but the last carries exactly payloadSize bytes, so a packet's place in the stream is its number
+// times payloadSize, and a run of them can go out as one send with udp segmentation offload. with forward error
+// correction, each group of k packets is followed by m parity packets, and any k of the k + m rebuild the group
+// without a round trip. a one way sender never hears back: it sends at a fixed rate, never resends, and the
+// receiver zero fills whatever the parity can't rebuild
+namespace rudp {
+    constexpr uint8_t typeData = 1;
+    constexpr uint8_t typeAck = 2;
+    constexpr uint8_t typeNak = 3;
+    constexpr uint8_t typeParity = 4;
+    constexpr uint8_t flagLast = 1;
+    constexpr uint8_t flagOneWay = 2;
+    constexpr size_t dataHeaderSize = 18;
+    constexpr size_t parityHeaderSize = 14;
+    constexpr size_t feedbackHeaderSize = 26;
+    constexpr size_t rangeSize = 16;
+    constexpr size_t payloadSize = 1400; // leaves room for the headers under a 1500 byte mtu
+    constexpr size_t packetSize = dataHeaderSize + payloadSize;
+    constexpr uint64_t window = 32768;   // packets out past the cumulative ack, about 45MiB
+    constexpr size_t maxRanges = 64;
+    constexpr size_t maxDatagram = 64 * 1024;
+    constexpr auto ackInterval = std::chrono::milliseconds{10};
+
+    struct Range {
+        uint64_t first;
+        uint64_t end;
+    };
+
+    uint64_t clockUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    Chunk feedback(uint8_t type, uint64_t cumulative, uint64_t echo, uint64_t rate, const std::vector<Range>& ranges) {
+        Chunk packet{static_cast<char>(type), static_cast<char>(std::min(ranges.size(), maxRanges))};
+        appendLe64(packet, cumulative);
+        appendLe64(packet, echo);
+        appendLe64(packet, rate);
+        for (size_t i = 0; i < ranges.size() && i < maxRanges; i++) {
+            appendLe64(packet, ranges[i].first);
+            appendLe64(packet, ranges[i].end);
+        }
+        return packet;
+    }
+
+    // the ranges of an ack or nak, as many as actually fit in what arrived
+    std::vector<Range> readRanges(std::span<const char> packet) {
+        std::vector<Range> ranges;
+        const size_t count = static_cast<uint8_t>(packet[1]);
+        for (size_t i = 0; i < count && feedbackHeaderSize + (i + 1) * rangeSize <= packet.size(); i++) {
+            const char* at = packet.data() + feedbackHeaderSize + i * rangeSize;
+            ranges.push_back({readLe64(at), readLe64(at + 8)});
+        }
+        return ranges;
+    }
+}
+
+// the receiving end of rudp as a SocketReader, reading a bound udp socket. packets are put back in order in a ring
+// of rudp::window slots and read() hands out runs of them straight from the ring. acks go back every ackInterval
+// while anything is arriving or missing, and a nak goes the moment a gap shows up, so the sender doesn't wait on a
+// timer to find out. once parity turns up, gaps are left to it and the acks instead: a packet the parity rebuilds
+// never needs resending. with receive coalescing the stack hands over up to 64KiB of datagrams per call
+class ReliableUdpReader : public SocketReader {
+private:
+    static constexpr auto oneWayHold = std::chrono::milliseconds{250}; // for the parity before a gap is given up on
+    static constexpr auto oneWayQuiet = std::chrono::seconds{2};       // before a feed that never sent its last is over
+
+    struct ParityGroup {
+        size_t count = 0;   // data packets in the group
+        bool ends = false;  // its last packet is the stream's last
+        size_t lastLength = rudp::payloadSize;
+        std::vector<std::pair<size_t, Chunk>> parity; // index, payload
+    };
+
+    SOCKET socket_;
+    sockaddr_storage peer_{};
+    int peerSize_ = 0;
+    std::vector<char> ring_;
+    std::vector<int32_t> lengths_; // payload bytes in each slot, -1 until it arrives
+    std::vector<bool> zeroFilled_; // given up on, so the slot's zeros aren't its data, even after it's handed out
+    uint64_t delivered_ = 0;       // first packet not handed out yet
+    uint64_t handedOut_ = 0;       // packets the last read() returned, freed on the next
+    uint64_t arrived_ = 0;         // first packet that hasn't arrived
+    uint64_t highest_ = 0;         // one past the highest packet seen
+    std::optional<uint64_t> last_;
+    uint64_t echo_ = 0;
+    uint64_t bytesSinceAck_ = 0;
+    bool ackDue_ = false;
+    std::chrono::steady_clock::time_point lastAck_ = std::chrono::steady_clock::now();
+    std::vector<char> datagram_;
+    RxTimestamps* rxTimestamps_;        // null unless stamping arrivals
+    LPFN_WSARECVMSG recvMsg_ = nullptr; // only while coalescing or stamping
+    bool coalescing_ = false;
+    uint64_t discarded_ = 0; // already had, or too far ahead for the ring
+    uint64_t naks_ = 0;
+    std::map<uint64_t, ParityGroup> groups_; // by first packet, until all of it has arrived
+    bool fec_ = false;    // the sender is sending parity
+    bool oneWay_ = false; // the sender isn't listening, so nothing the parity doesn't rebuild will come again
+    std::deque<std::pair<uint64_t, std::chrono::steady_clock::time_point>> gaps_; // one way: each jump ahead, and when
+    std::chrono::steady_clock::time_point lastArrival_ = std::chrono::steady_clock::now();
+    uint64_t recovered_ = 0;
+    uint64_t lost_ = 0;
+    bool cutShort_ = false;
+
+    void sendFeedback(const Chunk& packet) {
+        sendto(socket_, packet.data(), static_cast<int>(packet.size()), 0, reinterpret_cast<const sockaddr*>(&peer_), peerSize_);
+    }
+
+    void ack() {
+        std::vector<rudp::Range> ranges;
+        for (uint64_t n = arrived_; n < highest_ && ranges.size() < rudp::maxRanges; n++) {
+            if (lengths_[n % rudp::window] < 0) continue;
+            if (!ranges.empty() && ranges.back().end == n) ranges.back().end++;
+            else ranges.push_back({n, n + 1});
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lastAck_).count();
+        sendFeedback(rudp::feedback(rudp::typeAck, arrived_, echo_, static_cast<uint64_t>(bytesSinceAck_ / seconds), ranges));
+        lastAck_ = std::chrono::steady_clock::now();
+        bytesSinceAck_ = 0;
+        ackDue_ = false;
+    }
+
+    void arrive(std::span<const char> packet, const sockaddr_storage& from, int fromSize) {
+        const bool data = packet.size() >= rudp::dataHeaderSize && packet[0] == rudp::typeData;
+        const bool parity = packet.size() >= rudp::parityHeaderSize + rudp::payloadSize && packet[0] == rudp::typeParity;
+        if (!data && !parity) return;
+        if (peerSize_ == 0) {
+            peer_ = from;
+            peerSize_ = fromSize;
+            // the first delivery rate shouldn't count however long we sat waiting for the sender
+            lastAck_ = std::chrono::steady_clock::now();
+        }
+        lastArrival_ = std::chrono::steady_clock::now();
+        bytesSinceAck_ += packet.size();
+        ackDue_ = true;
+        if (parity) {
+            arriveParity(packet);
+            return;
+        }
+
+        const uint64_t n = readLe64(packet.data() + 2);
+        echo_ = std::max(echo_, readLe64(packet.data() + 10));
+        if (packet[1] & rudp::flagOneWay) oneWay_ = true;
+        // past the window means the sender got ahead of what we'd told it; it'll come round again
+        if (n < arrived_ || n >= delivered_ + rudp::window || lengths_[n % rudp::window] >= 0) {
+            discarded_++;
+            return;
+        }
+
+        const size_t payload = std::min(packet.size() - rudp::dataHeaderSize, rudp::payloadSize);
+        std::memcpy(ring_.data() + (n % rudp::window) * rudp::payloadSize, packet.data() + rudp::dataHeaderSize, payload);
+        lengths_[n % rudp::window] = static_cast<int32_t>(payload);
+        zeroFilled_[n % rudp::window] = false;
+        if (packet[1] & rudp::flagLast) last_ = n;
+        if (n > highest_ && oneWay_) gaps_.emplace_back(n, lastArrival_);
+        else if (n > highest_ && !fec_) {
+            sendFeedback(rudp::feedback(rudp::typeNak, arrived_, echo_, 0, {{highest_, n}}));
+            naks_++;
+        }
+        highest_ = std::max(highest_, n + 1);
+        if (fec_) {
+            auto group = groups_.upper_bound(n);
+            if (group != groups_.begin() && n < (--group)->first + group->second.count) recover(group);
+        }
+        advance();
+    }
+
+    void arriveParity(std::span<const char> packet) {
+        fec_ = true;
+        const uint64_t first = readLe64(packet.data() + 2);
+        const size_t count = static_cast<uint8_t>(packet[10]);
+        const size_t index = static_cast<uint8_t>(packet[11]);
+        const size_t lastLength = static_cast<uint8_t>(packet[12]) | static_cast<size_t>(static_cast<uint8_t>(packet[13])) << 8;
+        // parity for a group that all turned up is the usual case, not worth counting
+        if (first + count <= arrived_) return;
+        if (count == 0 || count + index > 255 || first + count > delivered_ + rudp::window) {
+            discarded_++;
+            return;
+        }
+        auto [group, added] = groups_.try_emplace(first);
+        ParityGroup& g = group->second;
+        if (added) {
+            g.count = count;
+            g.ends = packet[1] & rudp::flagLast;
+            g.lastLength = std::min(lastLength, rudp::payloadSize);
+        }
+        for (const auto& [had, payload] : g.parity) {
+            if (had == index) return;
+        }
+        const char* payload = packet.data() + rudp::parityHeaderSize;
+        g.parity.emplace_back(index, Chunk(payload, payload + rudp::payloadSize));
+        recover(group);
+        advance();
+    }
+
+    // rebuilds a group's missing packets once it has as many parity packets as holes: each parity is a known
+    // combination of the group's packets, so with the ones we have taken back out, what's left is a small system in
+    // the missing ones, solved with the same cauchy rows and gf256 arithmetic as the erasure coded sink. a packet
+    // that was given up on and zero filled counts as missing too, since its zeros aren't what was sent
+    void recover(std::map<uint64_t, ParityGroup>::iterator group) {
+        const uint64_t first = group->first;
+        const ParityGroup& g = group->second;
+        std::vector<size_t> missing;
+        for (size_t i = 0; i < g.count; i++) {
+            const uint64_t n = first + i;
+            const int32_t length = lengths_[n % rudp::window];
+            // already handed out; its payload is still in the ring unless a packet a window later took the slot
+            if (n < delivered_ && length >= 0) return;
+            if ((n >= delivered_ && length < 0) || zeroFilled_[n % rudp::window]) missing.push_back(i);
+        }
+        if (missing.size() > g.parity.size()) return;
+        if (missing.empty()) {
+            groups_.erase(group);
+            return;
+        }
+
+        auto payload = [this](uint64_t n) { return reinterpret_cast<uint8_t*>(ring_.data() + (n % rudp::window) * rudp::payloadSize); };
+        std::vector<std::vector<uint8_t>> matrix(missing.size(), std::vector<uint8_t>(missing.size()));
+        std::vector<Chunk> residues;
+        for (size_t r = 0; r < missing.size(); r++) {
+            const auto& [index, parity] = g.parity[r];
+            const std::vector<uint8_t> row = gf256::generatorRow(g.count, g.count + index);
+            Chunk residue = parity;
+            for (size_t i = 0, m = 0; i < g.count; i++) {
+                if (m < missing.size() && missing[m] == i) {
+                    matrix[r][m++] = row[i];
+                    continue;
+                }
+                const uint64_t n = first + i;
+                const size_t length = n < delivered_ ? rudp::payloadSize : lengths_[n % rudp::window];
+                gf256::mulAdd(row[i], payload(n), reinterpret_cast<uint8_t*>(residue.data()), length);
+            }
+            residues.push_back(std::move(residue));
+        }
+        if (!gf256::invert(matrix)) return;
+
+        for (size_t m = 0; m < missing.size(); m++) {
+            const uint64_t n = first + missing[m];
+            // a zero filled packet that's already gone out stays lost; only its place in the system mattered
+            if (n < delivered_) continue;
+            uint8_t* out = payload(n);
+            std::memset(out, 0, rudp::payloadSize);
+            for (size_t r = 0; r < residues.size(); r++) {
+                gf256::mulAdd(matrix[m][r], reinterpret_cast<const uint8_t*>(residues[r].data()), out, rudp::payloadSize);
+            }
+            const bool last = g.ends && missing[m] == g.count - 1;
+            lengths_[n % rudp::window] = static_cast<int32_t>(last ? g.lastLength : rudp::payloadSize);
+            if (zeroFilled_[n % rudp::window]) {
+                zeroFilled_[n % rudp::window] = false;
+                lost_--;
+            }
+            if (last) last_ = n;
+            highest_ = std::max(highest_, n + 1);
+            recovered_++;
+        }
+        groups_.erase(group);
+    }
+
+    void advance() {
+        while (arrived_ < highest_ && lengths_[arrived_ % rudp::window] >= 0) arrived_++;
+        while (!groups_.empty() && groups_.begin()->first + groups_.begin()->second.count <= arrived_) groups_.erase(groups_.begin());
+    }
+
+    // a one way sender won't fill a gap, so once the parity has had its chance the hole is zero filled to keep
+    // everything after it at the right offset; and with no last packet after a long silence, the feed is over
+    void giveUp() {
+        const auto now = std::chrono::steady_clock::now();
+        while (!gaps_.empty() && (gaps_.front().first <= arrived_ || now - gaps_.front().second > oneWayHold)) {
+            const uint64_t end = gaps_.front().first;
+            gaps_.pop_front();
+            for (uint64_t n = arrived_; n < end; n++) {
+                if (lengths_[n % rudp::window] >= 0) continue;
+                std::memset(ring_.data() + (n % rudp::window) * rudp::payloadSize, 0, rudp::payloadSize);
+                lengths_[n % rudp::window] = static_cast<int32_t>(rudp::payloadSize);
+                zeroFilled_[n % rudp::window] = true;
+                lost_++;
+            }
+            advance();
+        }
+        if (arrived_ == highest_ && !last_ && arrived_ > 0 && now - lastArrival_ > oneWayQuiet) {
+            last_ = arrived_ - 1;
+            cutShort_ = true;
+        }
+    }
+
+    // everything already waiting on the socket; false if there was nothing
+    bool receiveWaiting() {
+        bool any = false;
+        for (int i = 0; i < 256; i++) {
+            sockaddr_storage from{};
+            int fromSize = sizeof(from);
+            DWORD received = 0;
+            DWORD segment = 0;
+            if (recvMsg_) {
+                WSABUF data{static_cast<ULONG>(datagram_.size()), datagram_.data()};
+                alignas(WSACMSGHDR) char control[WSA_CMSG_SPACE(sizeof(DWORD)) + RxTimestamps::controlSize];
+                WSAMSG msg{};
+                msg.name = reinterpret_cast<sockaddr*>(&from);
+                msg.namelen = fromSize;
+                msg.lpBuffers = &data;
+                msg.dwBufferCount = 1;
+                msg.Control = {sizeof(control), control};
+                if (recvMsg_(socket_, &msg, &received, NULL, NULL) == SOCKET_ERROR) break;
+                if (rxTimestamps_) rxTimestamps_->record(msg);
+                fromSize = msg.namelen;
+                for (WSACMSGHDR* c = WSA_CMSG_FIRSTHDR(&msg); c; c = WSA_CMSG_NXTHDR(&msg, c)) {
+                    if (c->cmsg_level == IPPROTO_UDP && c->cmsg_type == UDP_COALESCED_INFO) {
+                        std::memcpy(&segment, WSA_CMSG_DATA(c), sizeof(segment));
+                    }
+                }
+            }
+            else {
+                const int n = recvfrom(socket_, datagram_.data(), static_cast<int>(datagram_.size()), 0, reinterpret_cast<sockaddr*>(&from), &fromSize);
+                if (n == SOCKET_ERROR) break;
+                received = n;
+            }
+            any = true;
+
+            // a coalesced buffer is back to back datagrams of `segment` bytes, the last maybe shorter
+            const size_t step = segment ? segment : received;
+            for (size_t at = 0; at < received; at += step) {
+                arrive({datagram_.data() + at, std::min<size_t>(step, received - at)}, from, fromSize);
+            }
+        }
+        if (WSAGetLastError() != WSAEWOULDBLOCK && !any) setError("udp receive failed: " + std::to_string(WSAGetLastError()));
+        return any;
+    }
+
+    // waits up to `timeout` for the socket to have something
+    void wait(std::chrono::milliseconds timeout) {
+        WSAPOLLFD fd{socket_, POLLRDNORM, 0};
+        WSAPoll(&fd, 1, static_cast<INT>(timeout.count()));
+    }
+
+    // the final ack can be lost like anything else, so keep answering until the sender goes quiet
+    void linger() {
+        ack();
+        auto quietSince = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - quietSince < std::chrono::milliseconds{500}) {
+            wait(std::chrono::milliseconds{100});
+            if (receiveWaiting()) {
+                ack();
+                quietSince = std::chrono::steady_clock::now();
+            }
+        }
+    }
+public:
+    // `rxTimestamps`, if given, is already enabled on the socket and outlives the reader
+    ReliableUdpReader(SOCKET socket, RxTimestamps* rxTimestamps)
+        : socket_(socket)
+        , ring_(rudp::window * rudp::payloadSize)
+        , lengths_(rudp::window, -1)
+        , zeroFilled_(rudp::window, false)
+        , datagram_(rudp::maxDatagram)
+        , rxTimestamps_(rxTimestamps) {
+        ULONG nonBlocking = 1;
+        ioctlsocket(socket_, FIONBIO, &nonBlocking);
+        // without this, an icmp port unreachable for an ack sent after the sender quit fails the next recv
+        BOOL reportReset = FALSE;
+        DWORD returned = 0;
+        WSAIoctl(socket_, SIO_UDP_CONNRESET, &reportReset, sizeof(reportReset), NULL, 0, &returned, NULL, NULL);
+        int bufferSize = 16 * 1024 * 1024;
+        setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize));
+
+        // receive coalescing needs WSARecvMsg to find out where one datagram ends and the next starts, and the
+        // arrival stamps come back in its control data
+        DWORD coalesce = static_cast<DWORD>(rudp::maxDatagram - 1);
+        GUID recvMsgId = WSAID_WSARECVMSG;
+        coalescing_ = setsockopt(socket_, IPPROTO_UDP, UDP_RECV_MAX_COALESCED_SIZE, reinterpret_cast<const char*>(&coalesce), sizeof(coalesce)) != SOCKET_ERROR;
+        if ((coalescing_ || rxTimestamps_)
+            && WSAIoctl(socket_, SIO_GET_EXTENSION_FUNCTION_POINTER, &recvMsgId, sizeof(recvMsgId),
+                        &recvMsg_, sizeof(recvMsg_), &returned, NULL, NULL) == SOCKET_ERROR) {
+            recvMsg_ = nullptr;
+            rxTimestamps_ = nullptr;
+            if (coalescing_) {
+                coalescing_ = false;
+                coalesce = 0;
+                setsockopt(socket_, IPPROTO_UDP, UDP_RECV_MAX_COALESCED_SIZE, reinterpret_cast<const char*>(&coalesce), sizeof(coalesce));
+            }
+        }
+    }
+
+    std::span<const char> read(size_t max) override {
+        for (uint64_t n = delivered_; n < delivered_ + handedOut_; n++) lengths_[n % rudp::window] = -1;
+        delivered_ += handedOut_;
+        handedOut_ = 0;
+
+        while (!error()) {
+            receiveWaiting();
+            const bool gap = arrived_ < highest_;
+            if (oneWay_) giveUp();
+            else if ((ackDue_ || gap) && std::chrono::steady_clock::now() - lastAck_ >= rudp::ackInterval) ack();
+            if (last_ && delivered_ > *last_) {
+                if (!oneWay_) linger();
+                return {};
+            }
+            if (delivered_ < arrived_) break;
+            wait(rudp::ackInterval);
+        }
+        if (error()) return {};
+
+        // a run of whole packets up to the end of the ring, or the last one, which may be short
+        const size_t slot = delivered_ % rudp::window;
+        const uint64_t count = std::min<uint64_t>({arrived_ - delivered_, std::max<size_t>(max / rudp::payloadSize, 1), rudp::window - slot});
+        handedOut_ = count;
+        const size_t bytes = (count - 1) * rudp::payloadSize + lengths_[(slot + count - 1) % rudp::window];
+        return {ring_.data() + slot * rudp::payloadSize, bytes};
+    }
+
+    std::string summary() const override {
+        std::string summary = std::to_string(delivered_) + " packets, ";
+        if (oneWay_) summary += "one way, ";
+        else summary += std::to_string(naks_) + " gaps reported, ";
+        if (fec_) summary += std::to_string(recovered_) + " rebuilt from parity, ";
+        if (lost_) summary += std::to_string(lost_) + " lost and zero filled, ";
+        if (cutShort_) summary += "the feed went quiet before its last packet, ";
+        return summary + std::to_string(discarded_) + " discarded" + (coalescing_ ? ", coalesced receives" : "");
+    }
+};
+
+// the sending end of rudp. keeps every packet past the cumulative ack for retransmits, and paces sends with a
+// token bucket filled at rate_: starting slow, growing by a quarter per ack until the first loss and by a couple
+// of percent after it, never more than a quarter over the delivery rate the receiver reports, and cut to seven
+// eighths of that rate at most once a round trip when packets go missing while delivery lags what's being sent. a gap the receiver naks is resent at
+// once; one that an ack still shows open a round trip after the last try is resent again, as is everything
+// outstanding if acks stop coming altogether. with udp segmentation offload a run of packets goes to the stack as
+// one send
+class ReliableUdpSender {
+private:
+    static constexpr double startRate = 4.0 * 1024 * 1024;  // bytes per second
+    static constexpr double minRate = 256.0 * 1024;
+    static constexpr size_t maxBatch = rudp::maxDatagram / rudp::packetSize;
+    static constexpr uint64_t giveUpUs = 30000000;
+    static constexpr auto burstTime = std::chrono::milliseconds{4}; // what the bucket holds, at the current rate
+
+    SOCKET socket_ = INVALID_SOCKET;
+    std::function<size_t(char*, size_t)> source_; // fills up to n bytes, fewer only at the end
+    const double maxRate_;
+    std::vector<char> ring_;
+    std::vector<uint32_t> lengths_;
+    std::vector<uint64_t> sentAt_; // clock of the last send of each packet in the window
+    std::vector<bool> sacked_;
+    std::deque<uint64_t> resend_;
+    std::deque<uint64_t> unsent_; // picked, but the send buffer was full
+    uint64_t acked_ = 0; // cumulative
+    uint64_t next_ = 0;  // first packet never sent
+    std::optional<uint64_t> last_;
+    bool segmentation_ = false;
+    size_t fecK_ = 0; // data packets per parity group, 0 for none
+    size_t fecM_ = 0; // parity packets per group
+    std::deque<Chunk> parity_; // ready to go, ahead of any more data
+    bool oneWay_ = false;
+
+    double rate_ = startRate;
+    double credit_ = 0;
+    std::chrono::steady_clock::time_point lastCredit_ = std::chrono::steady_clock::now();
+    std::array<double, 16> deliveryRates_{}; // the receiver's last few reports; one 10ms sample is noisy
+    size_t deliveryAt_ = 0;
+    double deliveryRate_ = 0; // the best of them
+    double srttUs_ = 0;
+    bool startup_ = true;
+    uint64_t lastCutUs_ = 0;
+    uint64_t lastProgressUs_ = rudp::clockUs();
+    uint64_t lastFeedbackUs_ = rudp::clockUs();
+
+    uint64_t sentPackets_ = 0;
+    uint64_t resentPackets_ = 0;
+    uint64_t parityPackets_ = 0;
+    uint64_t bytes_ = 0;
+    std::optional<std::string> error_;
+
+    void setError(std::string msg) {
+        error_ = std::move(msg);
+    }
+
+    // the m parity packets for packets first..last, which are still in the ring; a short last packet counts as
+    // zero padded, and the parity header says how long it really was
+    void addParity(uint64_t first, uint64_t last) {
+        const size_t count = static_cast<size_t>(last - first + 1);
+        const uint32_t lastLength = lengths_[last % rudp::window];
+        for (size_t j = 0; j < fecM_; j++) {
+            Chunk packet{static_cast<char>(rudp::typeParity), static_cast<char>(last_ == last ? rudp::flagLast : 0)};
+            appendLe64(packet, first);
+            packet.push_back(static_cast<char>(count));
+            packet.push_back(static_cast<char>(j));
+            packet.push_back(static_cast<char>(lastLength));
+            packet.push_back(static_cast<char>(lastLength >> 8));
+            packet.resize(rudp::parityHeaderSize + rudp::payloadSize);
+            const std::vector<uint8_t> row = gf256::generatorRow(count, count + j);
+            uint8_t* out = reinterpret_cast<uint8_t*>(packet.data() + rudp::parityHeaderSize);
+            for (size_t i = 0; i < count; i++) {
+                const size_t slot = (first + i) % rudp::window;
+                gf256::mulAdd(row[i], reinterpret_cast<const uint8_t*>(ring_.data() + slot * rudp::payloadSize), out, lengths_[slot]);
+            }
+            parity_.push_back(std::move(packet));
+        }
+    }
+
+    uint64_t rttUs() const {
+        return srttUs_ > 0 ? static_cast<uint64_t>(srttUs_) : 1000000;
+    }
+
+    void cutRate(uint64_t now) {
+        if (now - lastCutUs_ < rttUs()) return;
+        // while nearly everything sent still gets through the loss is the link's own, not a queue overflowing
+        if (deliveryRate_ > rate_ * 0.9) return;
+        rate_ = std::max(minRate, std::min(rate_, deliveryRate_ > 0 ? deliveryRate_ : rate_) * 0.875);
+        startup_ = false;
+        lastCutUs_ = now;
+    }
+
+    void lost(uint64_t n, uint64_t olderThanUs, uint64_t now) {
+        if (n < acked_ || n >= next_ || sacked_[n % rudp::window] || now - sentAt_[n % rudp::window] < olderThanUs) return;
+        resend_.push_back(n);
+        // not again until this one has had its chance
+        sentAt_[n % rudp::window] = now;
+    }
+
+    void onAck(std::span<const char> packet, uint64_t now) {
+        const uint64_t cumulative = std::min(readLe64(packet.data() + 2), next_);
+        const uint64_t echo = readLe64(packet.data() + 10);
+        deliveryRates_[deliveryAt_++ % deliveryRates_.size()] = static_cast<double>(readLe64(packet.data() + 18));
+        deliveryRate_ = *std::max_element(deliveryRates_.begin(), deliveryRates_.end());
+        if (echo && echo <= now) {
+            const double sample = static_cast<double>(now - echo);
+            srttUs_ = srttUs_ > 0 ? 0.875 * srttUs_ + 0.125 * sample : sample;
+        }
+        if (cumulative > acked_) {
+            for (uint64_t n = acked_; n < cumulative; n++) sacked_[n % rudp::window] = false;
+            acked_ = cumulative;
+            lastProgressUs_ = now;
+        }
+
+        uint64_t highest = acked_;
+        for (const rudp::Range& range : rudp::readRanges(packet)) {
+            for (uint64_t n = std::max(range.first, acked_); n < std::min(range.end, next_); n++) sacked_[n % rudp::window] = true;
+            highest = std::max(highest, std::min(range.end, next_));
+        }
+        // still open a round trip after it was last sent; the nak, or the resend, went missing too
+        const size_t queued = resend_.size();
+        for (uint64_t n = acked_; n < highest; n++) lost(n, rttUs() + 2 * std::chrono::duration_cast<std::chrono::microseconds>(rudp::ackInterval).count(), now);
+        if (resend_.size() > queued) cutRate(now);
+        else if (deliveryRate_ > 0) {
+            rate_ *= startup_ ? 1.25 : 1.02;
+            rate_ = std::min(rate_, std::max(deliveryRate_ * 1.25, minRate));
+        }
+        rate_ = std::min(rate_, maxRate_);
+    }
+
+    void onNak(std::span<const char> packet, uint64_t now) {
+        for (const rudp::Range& range : rudp::readRanges(packet)) {
+            for (uint64_t n = range.first; n < range.end && n < next_; n++) lost(n, rttUs() / 2, now);
+        }
+        cutRate(now);
+    }
+
+    void receiveFeedback() {
+        char packet[rudp::feedbackHeaderSize + rudp::maxRanges * rudp::rangeSize];
+        while (true) {
+            const int n = recv(socket_, packet, sizeof(packet), 0);
+            if (n == SOCKET_ERROR) return;
+            if (n < static_cast<int>(rudp::feedbackHeaderSize)) continue;
+            const uint64_t now = rudp::clockUs();
+            lastFeedbackUs_ = now;
+            if (packet[0] == rudp::typeAck) onAck({packet, static_cast<size_t>(n)}, now);
+            else if (packet[0] == rudp::typeNak) onNak({packet, static_cast<size_t>(n)}, now);
+        }
+    }
+
+    // nothing acked for a while: the acks, or everything we sent, went missing
+    void checkTimeout(uint64_t now) {
+        const uint64_t timeout = std::max<uint64_t>(3 * rttUs(), 300000);
+        if (acked_ == next_ || now - lastProgressUs_ < timeout) return;
+        for (uint64_t n = acked_; n < next_ && resend_.size() < maxBatch * 16; n++) lost(n, timeout, now);
+        rate_ = std::max(minRate, rate_ / 2);
+        startup_ = false;
+        lastProgressUs_ = now;
+    }
+
+    // the next packet number to send, resends first; nullopt if there's nothing the window allows
+    std::optional<uint64_t> pick() {
+        while (!unsent_.empty()) {
+            const uint64_t n = unsent_.front();
+            unsent_.pop_front();
+            if (n >= acked_ && !sacked_[n % rudp::window]) return n;
+        }
+        while (!resend_.empty()) {
+            const uint64_t n = resend_.front();
+            resend_.pop_front();
+            if (n >= acked_ && !sacked_[n % rudp::window]) {
+                resentPackets_++;
+                return n;
+            }
+        }
+        if (last_ || next_ >= acked_ + rudp::window) return std::nullopt;
+
+        const uint64_t n = next_++;
+        char* payload = ring_.data() + (n % rudp::window) * rudp::payloadSize;
+        size_t filled = 0;
+        while (filled < rudp::payloadSize) {
+            const size_t got = source_(payload + filled, rudp::payloadSize - filled);
+            if (got == 0) break;
+            filled += got;
+        }
+        lengths_[n % rudp::window] = static_cast<uint32_t>(filled);
+        sacked_[n % rudp::window] = false;
+        if (filled < rudp::payloadSize) last_ = n;
+        bytes_ += filled;
+        if (fecK_ && ((n + 1) % fecK_ == 0 || last_ == n)) addParity(n - n % fecK_, n);
+        return n;
+    }
+
+    void appendPacket(Chunk& batch, uint64_t n, uint64_t now) {
+        const size_t slot = n % rudp::window;
+        batch.push_back(static_cast<char>(rudp::typeData));
+        batch.push_back(static_cast<char>((last_ == n ? rudp::flagLast : 0) | (oneWay_ ? rudp::flagOneWay : 0)));
+        appendLe64(batch, n);
+        appendLe64(batch, now);
+        const char* payload = ring_.data() + slot * rudp::payloadSize;
+        batch.insert(batch.end(), payload, payload + lengths_[slot]);
+        sentAt_[slot] = now;
+        sentPackets_++;
+    }
+
+    // one send with segmentation offload, or one per packet without; returns the bytes that went, which without
+    // offload can be the first few packets of the batch
+    size_t sendBatch(const Chunk& batch) {
+        if (segmentation_) return send(socket_, batch.data(), static_cast<int>(batch.size()), 0) == SOCKET_ERROR ? 0 : batch.size();
+        for (size_t at = 0; at < batch.size(); at += rudp::packetSize) {
+            const int size = static_cast<int>(std::min(rudp::packetSize, batch.size() - at));
+            if (send(socket_, batch.data() + at, size, 0) == SOCKET_ERROR) return at;
+        }
+        return batch.size();
+    }
+public:
+    ReliableUdpSender(const sockaddr_storage& target, int targetSize, std::function<size_t(char*, size_t)> source, double maxRate)
+        : source_(std::move(source))
+        , maxRate_(maxRate > 0 ? maxRate : 1e12)
+        , ring_(rudp::window * rudp::payloadSize)
+        , lengths_(rudp::window)
+        , sentAt_(rudp::window)
+        , sacked_(rudp::window) {
+        rate_ = std::min(rate_, maxRate_);
+        socket_ = socket(target.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+        if (socket_ == INVALID_SOCKET || connect(socket_, reinterpret_cast<const sockaddr*>(&target), targetSize) == SOCKET_ERROR) {
+            setError("couldn't open a udp socket to the receiver: " + std::to_string(WSAGetLastError()));
+            return;
+        }
+        ULONG nonBlocking = 1;
+        ioctlsocket(socket_, FIONBIO, &nonBlocking);
+        // without this, an icmp port unreachable for an earlier packet fails the next recv
+        BOOL reportReset = FALSE;
+        DWORD returned = 0;
+        WSAIoctl(socket_, SIO_UDP_CONNRESET, &reportReset, sizeof(reportReset), NULL, 0, &returned, NULL, NULL);
+        int bufferSize = 4 * 1024 * 1024;
+        setsockopt(socket_, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize));
+        DWORD segment = static_cast<DWORD>(rudp::packetSize);
+        segmentation_ = setsockopt(socket_, IPPROTO_UDP, UDP_SEND_MSG_SIZE, reinterpret_cast<const char*>(&segment), sizeof(segment)) != SOCKET_ERROR;
+    }
+
+    ~ReliableUdpSender() {
+        if (socket_ != INVALID_SOCKET) closesocket(socket_);
+    }
+
+    // m parity packets after every k data packets, so the receiver can rebuild up to m lost from each group
+    void useFec(size_t k, size_t m) {
+        fecK_ = k;
+        fecM_ = m;
+    }
+
+    // for a receiver that can't answer: send everything once at the maximum rate and don't wait to hear back
+    void oneWay() {
+        oneWay_ = true;
+        rate_ = maxRate_;
+    }
+
+    // sends everything the source has and returns once the receiver has acked it all
+    void run() {
+        if (error_) return;
+        Chunk batch;
+        batch.reserve(rudp::maxDatagram);
+        std::vector<uint64_t> inBatch;
+        while (oneWay_ ? !last_ || next_ <= *last_ || !parity_.empty() || !unsent_.empty() : !last_ || acked_ <= *last_) {
+            if (!oneWay_) receiveFeedback();
+            const uint64_t now = rudp::clockUs();
+            if (!oneWay_) {
+                if (now - lastFeedbackUs_ > giveUpUs) {
+                    setError("the receiver stopped answering");
+                    return;
+                }
+                checkTimeout(now);
+            }
+
+            const auto tick = std::chrono::steady_clock::now();
+            credit_ = std::min(credit_ + rate_ * std::chrono::duration<double>(tick - lastCredit_).count(),
+                               std::max(rate_ * std::chrono::duration<double>(burstTime).count(), static_cast<double>(maxBatch * rudp::packetSize)));
+            lastCredit_ = tick;
+
+            bool sent = false;
+            while (credit_ >= rudp::packetSize) {
+                // parity is a different size, so it goes on its own rather than in a segmented batch
+                if (!parity_.empty()) {
+                    const Chunk& packet = parity_.front();
+                    if (send(socket_, packet.data(), static_cast<int>(packet.size()), 0) == SOCKET_ERROR) {
+                        if (WSAGetLastError() == WSAEWOULDBLOCK) break;
+                        setError("udp send failed: " + std::to_string(WSAGetLastError()));
+                        return;
+                    }
+                    credit_ -= packet.size();
+                    parity_.pop_front();
+                    parityPackets_++;
+                    sent = true;
+                    continue;
+                }
+                batch.clear();
+                inBatch.clear();
+                while (batch.size() + rudp::packetSize <= rudp::maxDatagram) {
+                    const auto n = pick();
+                    if (!n) break;
+                    appendPacket(batch, *n, now);
+                    inBatch.push_back(*n);
+                    // segments after a short one would be cut in the wrong places
+                    if (lengths_[*n % rudp::window] < rudp::payloadSize) break;
+                }
+                if (batch.empty()) break;
+                const size_t went = sendBatch(batch);
+                credit_ -= went;
+                if (went < batch.size()) {
+                    if (WSAGetLastError() != WSAEWOULDBLOCK) {
+                        setError("udp send failed: " + std::to_string(WSAGetLastError()));
+                        return;
+                    }
+                    // the send buffer's full; the packets that didn't go, go first once it drains rather than waiting
+                    // to be missed. every packet but a batch's last is full size, so they're counted off the front
+                    const size_t packetsWent = went / rudp::packetSize;
+                    unsent_.insert(unsent_.end(), inBatch.begin() + packetsWent, inBatch.end());
+                    sentPackets_ -= inBatch.size() - packetsWent;
+                    sent = false;
+                    break;
+                }
+                sent = true;
+                // nothing will ack it, so the window moves on as soon as it's gone
+                if (oneWay_) acked_ = next_;
+            }
+            if (!sent) {
+                WSAPOLLFD fd{socket_, POLLRDNORM, 0};
+                WSAPoll(&fd, 1, 1);
+            }
+        }
+    }
+
+    void report(std::ostream& os, double seconds) const {
+        os << bytes_ << " bytes in " << seconds << "s for " << bytes_ / seconds / 1024 / 1024 << " MiB/s over rudp, ";
+        if (oneWay_) os << sentPackets_ << " packets one way";
+        else os << resentPackets_ << " of " << sentPackets_ << " packets resent, rtt " << srttUs_ / 1000 << "ms, final rate " << rate_ / 1024 / 1024 << " MiB/s";
+        if (fecK_) os << ", " << parityPackets_ << " parity packets";
+        os << (segmentation_ ? ", segmentation offload" : "") << std::endl;
+    }
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+// which read engines work on this machine and how fast each drains a loopback connection, so the receiver can
+// start on the fastest without anyone picking by hand. probing takes a moment, so the results are kept in a small
+// state file and only redone when windows is updated (a new build can bring or fix an engine) or when asked
+namespace engines {
+    constexpr uint64_t probeBytes = 64 * 1024 * 1024; // 64MiB
+    constexpr int probeRounds = 3;
+    constexpr std::string_view header = "dumpsock read engines";
+
+    struct Probe {
+        ReadEngine engine;
+        double MiBps = 0;    // best of the rounds
+        std::string failure; // why it can't be used here, if it can't
+    };
+
+    uint32_t osBuild() {
+        using RtlGetVersionFn = LONG(WINAPI*)(PRTL_OSVERSIONINFOW);
+        const auto getVersion = reinterpret_cast<RtlGetVersionFn>(GetProcAddress(GetModuleHandleA("ntdll.dll"), "RtlGetVersion"));
+        RTL_OSVERSIONINFOW info{sizeof(info)};
+        return getVersion && getVersion(&info) == 0 ? info.dwBuildNumber : 0;
+    }
+
+    std::string cachePath() {
+        const char* localAppData = std::getenv("LOCALAPPDATA");
+        if (!localAppData) return "dumpsock-engines.txt";
+        const std::string dir = std::string{localAppData} + "\\dumpsock";
+        CreateDirectoryA(dir.c_str(), NULL);
+        return dir + "\\engines.txt";
+    }
+
+    // one loopback transfer read with `engine`, in MiB/s
+    std::optional<double> transfer(ReadEngine engine, std::string& failure) {
+        SOCKET listener = readEngineSocket(engine == ReadEngine::rio);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int addrSize = sizeof(addr);
+        if (listener == INVALID_SOCKET
+            || bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR
+            || listen(listener, 1) == SOCKET_ERROR
+            || getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &addrSize) == SOCKET_ERROR) {
+            failure = "couldn't listen on loopback: " + std::to_string(WSAGetLastError());
+            if (listener != INVALID_SOCKET) closesocket(listener);
+            return std::nullopt;
+        }
+
+        std::thread sender([addr] {
+            SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (connect(s, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != SOCKET_ERROR) {
+                std::vector<char> payload(256 * 1024, 'x');
+                for (uint64_t sent = 0; sent < probeBytes;) {
+                    const int n = send(s, payload.data(), static_cast<int>(std::min<uint64_t>(payload.size(), probeBytes - sent)), 0);
+                    if (n == SOCKET_ERROR) break;
+                    sent += n;
+                }
+            }
+            closesocket(s);
+        });
+
+        std::optional<double> MiBps;
+        SOCKET s = accept(listener, NULL, NULL);
+        if (s == INVALID_SOCKET) {
+            failure = "accept failed: " + std::to_string(WSAGetLastError());
+        }
+        else {
+            const auto start = std::chrono::steady_clock::now();
+            auto reader = makeSocketReader(engine, s, defaultReadSize(engine));
+            uint64_t received = 0;
+            while (!reader->error()) {
+                const auto data = reader->read(defaultReadSize(engine));
+                if (data.empty()) break;
+                received += data.size();
+            }
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (reader->error()) failure = *reader->error();
+            else if (received != probeBytes) failure = "read " + std::to_string(received) + " of " + std::to_string(probeBytes) + " bytes";
+            else MiBps = received / seconds / 1024 / 1024;
+            closesocket(s);
+        }
+        sender.join();
+        closesocket(listener);
+        return MiBps;
+    }
+
+    std::vector<Probe> probe() {
+        WSADATA wsaData;
+        WSAStartup(MAKEWORD(2, 2), &wsaData);
+        std::vector<Probe> probes;
+        for (ReadEngine engine : readEngines) {
+            Probe probe{engine};
+            for (int round = 0; round < probeRounds && probe.failure.empty(); round++) {
+                if (auto MiBps = transfer(engine, probe.failure)) probe.MiBps = std::max(probe.MiBps, *MiBps);
+            }
+            if (!probe.failure.empty()) probe.MiBps = 0;
+            probes.push_back(std::move(probe));
+        }
+        WSACleanup();
+        return probes;
+    }
+
+    // header line, the windows build, then one line per engine: its name and MiB/s, or its name, - and why not
+    bool save(const std::string& path, uint32_t build, const std::vector<Probe>& probes) {
+        std::ofstream file{path};
+        file << header << std::endl << "build " << build << std::endl;
+        for (const Probe& probe : probes) {
+            file << readEngineName(probe.engine) << " ";
+            if (probe.failure.empty()) file << probe.MiBps << std::endl;
+            else file << "- " << probe.failure << std::endl;
+        }
+        return static_cast<bool>(file);
+    }
+
+    // nullopt if there's no state file, it can't be read, or it was written on a different build
+    std::optional<std::vector<Probe>> load(const std::string& path, uint32_t build) {
+        std::ifstream file{path};
+        std::string line;
+        if (!std::getline(file, line) || line != header) return std::nullopt;
+        if (!std::getline(file, line) || line != "build " + std::to_string(build)) return std::nullopt;
+
+        std::vector<Probe> probes;
+        while (std::getline(file, line)) {
+            const size_t space = line.find(' ');
+            const auto engine = readEngineForName(std::string_view{line}.substr(0, space));
+            if (space == std::string::npos || !engine) return std::nullopt;
+            Probe probe{*engine};
+            const std::string_view rest = std::string_view{line}.substr(space + 1);
+            if (rest.starts_with("-")) {
+                probe.failure = rest.size() > 2 ? std::string{rest.substr(2)} : "unavailable";
+            }
+            else if (std::from_chars(rest.data(), rest.data() + rest.size(), probe.MiBps).ec != std::errc{}) {
+                return std::nullopt;
+            }
+            probes.push_back(std::move(probe));
+        }
+        return probes;
+    }
+
+    // the engines that worked, fastest first, with recv always there at the end to fall back on
+    std::vector<ReadEngine> rank(std::vector<Probe> probes) {
+        std::erase_if(probes, [](const Probe& probe) { return !probe.failure.empty(); });
+        std::stable_sort(probes.begin(), probes.end(), [](const Probe& a, const Probe& b) { return a.MiBps > b.MiBps; });
+        std::vector<ReadEngine> ranked;
+        for (const Probe& probe : probes) ranked.push_back(probe.engine);
+        if (std::find(ranked.begin(), ranked.end(), ReadEngine::recv) == ranked.end()) ranked.push_back(ReadEngine::recv);
+        return ranked;
+    }
+
+    // the ranking from the state file, probing first if it's missing, stale or `reprobe` is set
+    std::vector<ReadEngine> choose(bool reprobe) {
+        const uint32_t build = osBuild();
+        const std::string path = cachePath();
+        std::optional<std::vector<Probe>> probes = reprobe ? std::nullopt : load(path, build);
+        if (!probes) {
+            std::cerr << "probing read engines..." << std::endl;
+            probes = probe();
+            for (const Probe& probe : *probes) {
+                std::cerr << "  " << readEngineName(probe.engine) << ": ";
+                if (probe.failure.empty()) std::cerr << probe.MiBps << " MiB/s on loopback" << std::endl;
+                else std::cerr << "unavailable, " << probe.failure << std::endl;
+            }
+            if (!save(path, build, *probes)) std::cerr << "warning: couldn't save the probe results to " << path << std::endl;
+        }
+        return rank(std::move(*probes));
+    }
+}
+
+// moves TuningKnobs while a transfer runs, one step at a time, keeping a step only if it measurably helped: hill
+// climbing on throughput, with cpu cycles per byte deciding when throughput doesn't move (a sender limited transfer
+// runs at the same speed whatever we do, so cpu is all there is left to win). each trial gets a short settle and then
+// one window of measurement. every pass over the knobs starts from a fresh measurement, so it follows a link that
+// changes under it
+class AutoTuner {
+private:
+    struct Measurement {
+        double MiBps;
+        double cyclesPerByte;
+    };
+
+    static constexpr std::chrono::milliseconds settle{100};
+    static constexpr std::chrono::milliseconds window{500};
+    static constexpr double throughputMargin = 0.03; // anything closer than this is noise
+    static constexpr double cpuMargin = 0.05;
+
+    std::vector<TuningKnob> knobs_;
+    const std::atomic<uint64_t>* bytes_ = nullptr;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    uint64_t trials_ = 0;
+    uint64_t kept_ = 0;
+
+    // nullopt once stopped
+    std::optional<Measurement> measure(std::unique_lock<std::mutex>& lock) {
+        if (wake_.wait_for(lock, settle, [&] { return stopping_; })) return std::nullopt;
+        const uint64_t bytesStart = *bytes_;
+        const CpuCounters cpuStart = CpuCounters::sample();
+        const auto start = std::chrono::steady_clock::now();
+        if (wake_.wait_for(lock, window, [&] { return stopping_; })) return std::nullopt;
+        const uint64_t bytes = *bytes_ - bytesStart;
+        const CpuCounters cpu = CpuCounters::sample() - cpuStart;
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return Measurement{bytes / seconds / 1024 / 1024, bytes ? static_cast<double>(cpu.processCycles) / bytes : 0};
+    }
+
+    static bool better(const Measurement& trial, const Measurement& current) {
+        if (trial.MiBps > current.MiBps * (1 + throughputMargin)) return true;
+        return trial.MiBps > 0
+            && trial.MiBps >= current.MiBps * (1 - throughputMargin)
+            && trial.cyclesPerByte < current.cyclesPerByte * (1 - cpuMargin);
+    }
+
+    static void set(TuningKnob& knob, size_t at) {
+        knob.at = at;
+        knob.apply(knob.values[at]);
+    }
+
+    // keeps stepping `knob` in one direction while that helps; false once stopped
+    bool climb(TuningKnob& knob, int direction, Measurement& current, std::unique_lock<std::mutex>& lock) {
+        while (direction > 0 ? knob.at + 1 < knob.values.size() : knob.at > 0) {
+            const size_t from = knob.at;
+            set(knob, from + direction);
+            trials_++;
+            const auto trial = measure(lock);
+            if (!trial || !better(*trial, current)) {
+                set(knob, from);
+                return trial.has_value();
+            }
+            current = *trial;
+            kept_++;
+            TraceLoggingWrite(traceProvider, "Tune",
+                TraceLoggingString(knob.name.c_str(), "Knob"),
+                TraceLoggingUInt64(knob.values[knob.at], "Value"),
+                TraceLoggingUInt64(static_cast<uint64_t>(trial->MiBps * 1024), "KiBps"));
+        }
+        return true;
+    }
+
+    void run() {
+        std::unique_lock lock{mutex_};
+        while (true) {
+            const auto current = measure(lock);
+            if (!current) return;
+            // nothing arriving means nothing to compare against
+            if (current->MiBps == 0) continue;
+
+            Measurement best = *current;
+            for (TuningKnob& knob : knobs_) {
+                const size_t before = knob.at;
+                if (!climb(knob, 1, best, lock)) return;
+                if (knob.at == before && !climb(knob, -1, best, lock)) return;
+            }
+        }
+    }
+public:
+    ~AutoTuner() {
+        stop();
+    }
+
+    void start(std::vector<TuningKnob> knobs, const std::atomic<uint64_t>& bytes) {
+        knobs_ = std::move(knobs);
+        bytes_ = &bytes;
+        for (TuningKnob& knob : knobs_) set(knob, knob.at);
+        thread_ = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        if (!thread_.joinable()) return;
+        {
+            std::lock_guard lock{mutex_};
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        thread_.join();
+    }
+
+    void report(std::ostream& os) const {
+        os << "  tuned";
+        for (const TuningKnob& knob : knobs_) {
+            os << (&knob == &knobs_.front() ? " " : ", ") << knob.name << " " << knob.label(knob.values[knob.at]);
+        }
+        os << " (" << kept_ << " of " << trials_ << " steps kept)" << std::endl;
+    }
+};
+
+class SocketDumper {
+private:
+    WSADATA wsaData_;
+    SOCKET socket_;
+    sockaddr_in addr_;
+    SOCKET incomingDataSocket_ = INVALID_SOCKET;
+    Pipeline& pipeline_;
+    std::atomic<uint64_t> bytesReceived_ = 0; // read by the tuner while the transfer runs
+    Histogram recvSizes_;   // bytes per recv
+    Histogram recvGaps_;    // ns between one recv returning and the next
+    bool countCpu_ = false;
+    CpuCounters receiveCpu_;
+    std::optional<std::chrono::milliseconds> tcpInfoInterval_;
+    TcpInfoSampler tcpInfo_;
+    bool rxTimestampsWanted_ = false;
+    std::optional<RxTimestamps> rxTimestamps_; // only if the stack took SIO_TIMESTAMPING
+    std::vector<ReadEngine> engines_ = {ReadEngine::recv}; // in order of preference
+    ReadEngine engine_ = ReadEngine::recv;
+    std::unique_ptr<SocketReader> reader_;
+    std::vector<std::unique_ptr<SocketReader>> abandoned_; // engines that fell back; their buffers stay until the socket's closed
+    Chunk carried_;        // what they'd already received, handed on before the next engine reads
+    size_t carriedAt_ = 0;
+    bool udp_ = false;                     // rudp on a bound udp socket rather than an accepted tcp connection
+    bool tune_ = false;
+    AutoTuner tuner_;
+    std::atomic<size_t> recvSize_ = 4096;
+    std::atomic<size_t> batchSize_ = 0; // recvs are gathered into one chunk until it's this big; 0 hands each on alone
+
+    std::optional<std::string> error_;
+
+    // create an ipv4 address in the win32 format that all the socket functions expect
+    sockaddr_in sockAddrForPort(uint16_t port) {
+        return {
+            .sin_family = AF_INET,
+            .sin_port = htons(port),
+            .sin_addr = {
+                .S_un = {
+                    .S_un_b = {
+                        .s_b1 = 0,
+                        .s_b2 = 0,
+                        .s_b3 = 0,
+                       .s_b4 = 0
+                   }
+                }
+            }
+        };
+    }
+
+    void setError(std::string msg) {
+        error_ = std::move(msg);
+    }
+
+    boolean hasError() const {
+        return error_.has_value();
+    }
+
+    // the first engine that sets up on the accepted socket; recv is always there to fall back on
+    void openReader(size_t bufferSize) {
+        for (ReadEngine engine : engines_) {
+            reader_ = makeSocketReader(engine, incomingDataSocket_, bufferSize ? bufferSize : defaultReadSize(engine));
+            if (!reader_->error()) {
+                engine_ = engine;
+                return;
+            }
+            std::cerr << "warning: " << readEngineName(engine) << ": " << *reader_->error() << ", falling back" << std::endl;
+            const Chunk received = reader_->abandon();
+            carried_.insert(carried_.end(), received.begin(), received.end());
+            abandoned_.push_back(std::move(reader_));
+        }
+        engine_ = ReadEngine::recv;
+        reader_ = makeSocketReader(engine_, incomingDataSocket_, bufferSize ? bufferSize : defaultReadSize(engine_));
+    }
+
+    // the next bytes off the socket, empty at the end of the stream or on an error
+    std::span<const char> receiveSome(size_t max) {
+        if (carriedAt_ < carried_.size()) {
+            const size_t take = std::min(max, carried_.size() - carriedAt_);
+            carriedAt_ += take;
+            return {carried_.data() + carriedAt_ - take, take};
+        }
+        const auto data = reader_->read(max);
+        if (auto err = reader_->error()) setError(*err);
+        return data;
+    }
+public:
+    explicit SocketDumper(Pipeline& pipeline) : pipeline_(pipeline) {}
+
+    // closing the socket cancels whatever the reader still has posted before it lets go of its buffers
+    ~SocketDumper() {
+        if (incomingDataSocket_ != INVALID_SOCKET) closesocket(incomingDataSocket_);
+    }
+
+    // read engines to try in order, best first
+    void useReadEngines(std::vector<ReadEngine> engines) {
+        engines_ = std::move(engines);
+    }
+
+    // receive from a rudp sender instead of accepting a tcp connection
+    void useUdp() {
+        udp_ = true;
+    }
+
+    // sample cpu counters around the receive (which includes every stage) and around the sink's commit
+    void countCpu() {
+        countCpu_ = true;
+    }
+
+    void sampleTcpInfo(std::chrono::milliseconds interval) {
+        tcpInfoInterval_ = interval;
+    }
+
+    void useRxTimestamps() {
+        rxTimestampsWanted_ = true;
+    }
+
+    // let the auto tuner pick the recv size, how much to gather per chunk, and whatever the pipeline offers
+    void autoTune() {
+        tune_ = true;
+    }
+
+    void initWsa() {
+        int iResult = WSAStartup(MAKEWORD(2, 2), &wsaData_);
+        if (iResult != 0) {
+            setError("WSAStartup failed: " + std::to_string(iResult));
+        }
+    }
+
+    void initTcpSocket(uint16_t port) {
+        if (hasError()) return;
+
+        socket_ = readEngineSocket(std::find(engines_.begin(), engines_.end(), ReadEngine::rio) != engines_.end());
+        if (socket_ == INVALID_SOCKET) {
+            setError("Couldn't create a tcp socket");
+            return;
+        }
+        addr_ = sockAddrForPort(port);
+    }
+
+    // there's nothing to accept, the bound socket is the one the data comes in on
+    void initUdpSocket(uint16_t port) {
+        if (hasError()) return;
+
+        socket_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (socket_ == INVALID_SOCKET) {
+            setError("Couldn't create a udp socket");
+            return;
+        }
+        incomingDataSocket_ = socket_;
+        addr_ = sockAddrForPort(port);
+    }
+
+    void bindSocket() {
+        if (hasError()) return;
+
+        int result = bind(socket_, (sockaddr*)&addr_, sizeof(sockaddr_in));
+        if (result == SOCKET_ERROR) {
+            setError("socket bind error");
+            return;
+        }
+    }
+
+    void listenSocket() {
+        if (hasError()) return;
+
+        int result = listen(socket_, /*backlog*/1);
+        if (result == SOCKET_ERROR) {
+            setError("socket listen error");
+            return;
+        }
+    }
+
+    void acceptSocket() {
+        if (hasError()) return;
+
+        const auto acceptStart = std::chrono::high_resolution_clock::now();
+        incomingDataSocket_ = accept(socket_, NULL, NULL);
+        if (incomingDataSocket_ == INVALID_SOCKET) {
+            setError("socket accept error");
+            return;
+        }
+        TraceLoggingWrite(traceProvider, "Accept", TraceLoggingUInt64(microsecondsSince(acceptStart), "WaitMicroseconds"));
+        timeline.record("accept", "socket", acceptStart, std::chrono::high_resolution_clock::now());
+    }
+
+    void drainSocket() {
+        if (hasError()) return;
+
+        if (rxTimestampsWanted_) {
+            rxTimestamps_.emplace();
+            rxTimestamps_->enable(incomingDataSocket_);
+            if (auto err = rxTimestamps_->error()) {
+                std::cerr << "warning: " << *err << ", no kernel receive timestamps" << std::endl;
+                rxTimestamps_.reset();
+            }
+        }
+
+        constexpr size_t maxTunedRecvSize = 1024 * 1024 * 1; // 1MiB
+
+        if (udp_) {
+            reader_ = std::make_unique<ReliableUdpReader>(incomingDataSocket_, rxTimestamps_ ? &*rxTimestamps_ : nullptr);
+        }
+        else {
+            openReader(tune_ ? maxTunedRecvSize : 0);
+        }
+        if (!tune_) recvSize_ = udp_ ? rudp::maxDatagram : defaultReadSize(engine_);
+        Chunk batch;
+
+        const auto recv_start = std::chrono::high_resolution_clock::now();
+        const CpuCounters cpuStart = countCpu_ ? CpuCounters::sample() : CpuCounters{};
+        if (tcpInfoInterval_) tcpInfo_.start(incomingDataSocket_, *tcpInfoInterval_);
+
+        std::vector<TuningKnob> knobs;
+        if (tune_) {
+            auto kib = [](size_t bytes) { return std::to_string(bytes / 1024) + "KiB"; };
+            TuningKnob recvSize{"recv size", {}, 0, [this](size_t size) { recvSize_ = size; }, kib};
+            for (size_t size = 4096; size <= maxTunedRecvSize; size *= 2) recvSize.values.push_back(size);
+            recvSize.at = 4; // 64KiB
+            knobs.push_back(std::move(recvSize));
+            knobs.push_back({"batch", {0, 128 * 1024, 256 * 1024, 512 * 1024, 1024 * 1024}, 0, [this](size_t size) { batchSize_ = size; }, kib});
+            for (auto& knob : pipeline_.tuningKnobs()) knobs.push_back(std::move(knob));
+        }
+
+        pipeline_.start();
+        if (tune_) tuner_.start(std::move(knobs), bytesReceived_);
+
+        // recv time runs from the end of one iteration to the return of the next recv, so it includes the wait for data
+        auto recvStart = std::chrono::high_resolution_clock::now();
+        std::optional<std::chrono::high_resolution_clock::time_point> lastArrival;
+        std::span<const char> data;
+        while (!(data = receiveSome(recvSize_.load(std::memory_order_relaxed))).empty()) {
+            const int readSize = static_cast<int>(data.size());
+            const auto handoffStart = std::chrono::high_resolution_clock::now();
+            recvSizes_.record(readSize);
+            if (lastArrival) recvGaps_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(handoffStart - *lastArrival).count());
+            lastArrival = handoffStart;
+
+            const bool tracing = traceEnabled();
+            if (tracing) {
+                TraceLoggingWrite(traceProvider, "Recv",
+                    TraceLoggingInt32(readSize, "Bytes"),
+                    TraceLoggingUInt64(std::chrono::duration_cast<std::chrono::microseconds>(handoffStart - recvStart).count(), "Microseconds"));
+                timeline.record("recv", "socket", recvStart, handoffStart, readSize);
+            }
+
+            // time spent here is backpressure from the first stage's queue
+            const size_t batchSize = batchSize_.load(std::memory_order_relaxed);
+            if (batch.empty() && batchSize == 0) {
+                pipeline_.push(Chunk(data.begin(), data.end()));
+            }
+            else {
+                if (batch.empty()) batch.reserve(batchSize);
+                batch.insert(batch.end(), data.begin(), data.end());
+                if (batch.size() >= batchSize) {
+                    pipeline_.push(std::move(batch));
+                    batch = Chunk{};
+                }
+            }
+            bytesReceived_.fetch_add(readSize, std::memory_order_relaxed);
+            if (tracing) {
+                recvStart = std::chrono::high_resolution_clock::now();
+                TraceLoggingWrite(traceProvider, "Handoff",
+                    TraceLoggingInt32(readSize, "Bytes"),
+                    TraceLoggingUInt64(std::chrono::duration_cast<std::chrono::microseconds>(recvStart - handoffStart).count(), "Microseconds"));
+                timeline.record("handoff", "socket", handoffStart, recvStart, readSize);
+            }
+        }
+
+        if (!batch.empty()) pipeline_.push(std::move(batch));
+        tuner_.stop();
+        tcpInfo_.stop();
+        const auto flushStart = std::chrono::high_resolution_clock::now();
+        pipeline_.finish();
+        TraceLoggingWrite(traceProvider, "PipelineFlushed",
+            TraceLoggingUInt64(bytesReceived_.load(), "Bytes"),
+            TraceLoggingUInt64(microsecondsSince(flushStart), "Microseconds"));
+        timeline.record("flush pipeline", "pipeline", flushStart, std::chrono::high_resolution_clock::now());
+        if (countCpu_) receiveCpu_ = CpuCounters::sample() - cpuStart;
+        if (hasError()) return;
+        if (auto err = pipeline_.error()) {
+            setError(*err);
+            return;
+        }
+
+        const auto recv_end = std::chrono::high_resolution_clock::now();
+
+        // bytes / ms * 1000 = bytes / s
+        const double Bps = static_cast<double>(bytesReceived_) / std::chrono::duration_cast<std::chrono::milliseconds>(recv_end - recv_start).count() * 1000.0;
+        const double KiBps = Bps / 1024;
+        const double MiBps = KiBps / 1024;
+
+        const double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(recv_end - recv_start).count() / 1000.0;
+
+        std::cerr << bytesReceived_ << " bytes in " << seconds << "s" << " for " << MiBps << " MiB/s";
+        if (udp_) std::cerr << " over rudp, " << reader_->summary() << std::endl;
+        else std::cerr << " with the " << readEngineName(engine_) << " read engine" << std::endl;
+        std::cerr << "  recv size ";
+        recvSizes_.describe(std::cerr, 1, "B");
+        std::cerr << std::endl << "  recv gap ";
+        recvGaps_.describe(std::cerr, 1000, "us");
+        std::cerr << std::endl;
+        tcpInfo_.report(std::cerr);
+        if (tune_) tuner_.report(std::cerr);
+        if (rxTimestamps_) rxTimestamps_->report(std::cerr);
+        pipeline_.report(std::cerr);
+        if (countCpu_) receiveCpu_.report(std::cerr, "receive", "receive", bytesReceived_);
+    }
+
+    void dump() {
+        if (!hasError()) {
+            const auto commitStart = std::chrono::high_resolution_clock::now();
+            const CpuCounters cpuStart = countCpu_ ? CpuCounters::sample() : CpuCounters{};
+            pipeline_.sink().commit();
+            if (countCpu_) (CpuCounters::sample() - cpuStart).report(std::cerr, "output", "committing", bytesReceived_);
+            TraceLoggingWrite(traceProvider, "SinkCommit", TraceLoggingUInt64(microsecondsSince(commitStart), "Microseconds"));
+            timeline.record("commit", "sink", commitStart, std::chrono::high_resolution_clock::now());
+            if (auto err = pipeline_.sink().error()) setError(*err);
+        }
+        else {
+            pipeline_.sink().abort();
+        }
+
+        if (hasError()) {
+            std::cerr << *error_ << std::endl;
+        }
+    }
+
+    int getExitCode() {
+        return hasError() ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+};
+
+// how many bytes each load generator connection sends: "N" every time, "MIN-MAX" uniformly, or "exp:MEAN"
+// exponentially, for the many small and few large mix real senders have
+class SizeDistribution {
+private:
+    enum class Kind { fixed, uniform, exponential };
+    Kind kind_ = Kind::fixed;
+    uint64_t a_ = 0;
+    uint64_t b_ = 0;
+public:
+    static std::optional<SizeDistribution> parse(std::string_view spec) {
+        SizeDistribution d;
+        if (spec.starts_with("exp:")) {
+            const auto mean = parseCount(spec.substr(4));
+            if (!mean || *mean == 0) return std::nullopt;
+            d.kind_ = Kind::exponential;
+            d.a_ = *mean;
+            return d;
+        }
+        if (const size_t dash = spec.find('-'); dash != std::string_view::npos) {
+            const auto low = parseCount(spec.substr(0, dash));
+            const auto high = parseCount(spec.substr(dash + 1));
+            if (!low || !high || *low > *high) return std::nullopt;
+            d.kind_ = Kind::uniform;
+            d.a_ = *low;
+            d.b_ = *high;
+            return d;
+        }
+        const auto size = parseCount(spec);
+        if (!size) return std::nullopt;
+        d.a_ = *size;
+        return d;
+    }
+
+    uint64_t draw(std::mt19937_64& rng) const {
+        switch (kind_) {
+            case Kind::uniform: return std::uniform_int_distribution<uint64_t>{a_, b_}(rng);
+            case Kind::exponential: return static_cast<uint64_t>(std::exponential_distribution<double>{1.0 / a_}(rng));
+            default: return a_;
+        }
+    }
+};
+
+struct LoadOptions {
+    std::string host;
+    std::string port;
+    size_t connections = 100;  // open at once
+    size_t total = 0;          // over the whole run; 0 means one round of `connections`
+    SizeDistribution sizes = *SizeDistribution::parse("1048576");
+    double rate = 0;           // bytes per second across every connection, 0 for as fast as possible
+    uint64_t burst = 64 * 1024; // bytes the pacer lets out at once after sitting idle
+};
+
+struct LoadResult {
+    uint64_t bytes = 0;
+    size_t completed = 0;
+    size_t failed = 0;
+    double seconds = 0;
+    Histogram connectNs;     // connect() to writable
+    Histogram completionNs;  // connect() to the receiver closing its end after the last byte
+    Histogram connectionBps; // per connection throughput, for fairness
+    double bpsSum = 0;
+    double bpsSquares = 0;
+
+    // jain's index over per connection throughput: 1 when every connection got the same, 1/n when one got it all
+    double fairness() const {
+        return bpsSquares > 0 ? bpsSum * bpsSum / (completed * bpsSquares) : 0;
+    }
+};
+
+// many concurrent senders from one thread: non-blocking sockets under WSAPoll, each connection sends one payload
+// drawn from `sizes`, shuts down its send side and counts as complete when the receiver closes, and a new one
+// takes its place until `total` have gone. a token bucket shared by all of them does the pacing; with a low rate
+// and a big burst the traffic comes in bursts with quiet gaps between them
+class LoadGenerator {
+private:
+    struct Connection {
+        SOCKET socket = INVALID_SOCKET;
+        uint64_t size = 0;
+        uint64_t sent = 0;
+        bool connected = false;
+        bool shutDown = false;
+        std::chrono::high_resolution_clock::time_point started;
+    };
+
+    static constexpr size_t payloadSize = 1024 * 1024 * 1; // 1MiB
+
+    const LoadOptions options_;
+    std::vector<char> payload_;
+    sockaddr_storage addr_{};
+    int addrLen_ = 0;
+    std::mt19937_64 rng_{std::random_device{}()};
+    std::vector<Connection> connections_;
+    std::vector<WSAPOLLFD> polls_;
+    std::optional<std::string> error_;
+
+    void setError(std::string msg) {
+        error_ = std::move(msg);
+    }
+
+    bool open() {
+        Connection c;
+        c.socket = socket(addr_.ss_family, SOCK_STREAM, IPPROTO_TCP);
+        if (c.socket == INVALID_SOCKET) return false;
+        ULONG nonBlocking = 1;
+        ioctlsocket(c.socket, FIONBIO, &nonBlocking);
+        c.size = options_.sizes.draw(rng_);
+        c.started = std::chrono::high_resolution_clock::now();
+        if (connect(c.socket, reinterpret_cast<sockaddr*>(&addr_), addrLen_) == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK) {
+            closesocket(c.socket);
+            return false;
+        }
+        connections_.push_back(c);
+        polls_.push_back({c.socket, 0, 0});
+        return true;
+    }
+
+    void close(size_t i, bool ok, LoadResult& result) {
+        const Connection& c = connections_[i];
+        const auto elapsed = std::chrono::high_resolution_clock::now() - c.started;
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        if (ok) {
+            result.completed++;
+            result.completionNs.record(ns);
+            const double bps = ns > 0 ? c.size * 1e9 / ns : 0;
+            result.connectionBps.record(static_cast<uint64_t>(bps));
+            result.bpsSum += bps;
+            result.bpsSquares += bps * bps;
+        }
+        else {
+            result.failed++;
+        }
+        closesocket(c.socket);
+        connections_[i] = connections_.back();
+        connections_.pop_back();
+        polls_[i] = polls_.back();
+        polls_.pop_back();
+    }
+public:
+    explicit LoadGenerator(LoadOptions options) : options_(std::move(options)), payload_(payloadSize) {
+        for (size_t i = 0; i < payload_.size(); i++) payload_[i] = static_cast<char>(i * 131 + (i >> 12));
+
+        WSADATA wsaData;
+        if (int err = WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+            setError("WSAStartup failed: " + std::to_string(err));
+            return;
+        }
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+        addrinfo* found = nullptr;
+        if (getaddrinfo(options_.host.c_str(), options_.port.c_str(), &hints, &found) != 0 || !found) {
+            setError("couldn't resolve " + options_.host);
+            return;
+        }
+        std::memcpy(&addr_, found->ai_addr, found->ai_addrlen);
+        addrLen_ = static_cast<int>(found->ai_addrlen);
+        freeaddrinfo(found);
+    }
+
+    ~LoadGenerator() {
+        for (const Connection& c : connections_) closesocket(c.socket);
+        WSACleanup();
+    }
+
+    LoadResult run() {
+        LoadResult result;
+        if (error_) return result;
+
+        const size_t total = options_.total ? options_.total : options_.connections;
+        size_t opened = 0;
+        double tokens = static_cast<double>(options_.burst);
+        char scratch[4096];
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        auto lastRefill = start;
+        while (result.completed + result.failed < total) {
+            while (connections_.size() < options_.connections && opened < total) {
+                opened++;
+                if (!open()) result.failed++;
+            }
+
+            const auto now = std::chrono::high_resolution_clock::now();
+            if (options_.rate > 0) {
+                tokens = std::min<double>(static_cast<double>(options_.burst), tokens + options_.rate * std::chrono::duration<double>(now - lastRefill).count());
+            }
+            lastRefill = now;
+            const bool mayWrite = options_.rate == 0 || tokens >= 1;
+
+            for (size_t i = 0; i < connections_.size(); i++) {
+                const Connection& c = connections_[i];
+                polls_[i].events = !c.connected ? POLLWRNORM : !c.shutDown ? (mayWrite ? POLLWRNORM : 0) : POLLRDNORM;
+                polls_[i].revents = 0;
+            }
+            // when the bucket is empty, sleep about as long as it takes to earn a few KiB back
+            const int timeout = mayWrite ? 100 : std::max(1, static_cast<int>(std::min<double>(options_.burst, 4096) / options_.rate * 1000));
+            if (polls_.empty()) continue;
+            if (WSAPoll(polls_.data(), static_cast<ULONG>(polls_.size()), timeout) == SOCKET_ERROR) {
+                setError("WSAPoll failed: " + std::to_string(WSAGetLastError()));
+                break;
+            }
+
+            for (size_t i = connections_.size(); i-- > 0;) {
+                Connection& c = connections_[i];
+                const short revents = polls_[i].revents;
+                if (revents == 0) continue;
+
+                if (!c.connected) {
+                    if (revents & (POLLERR | POLLHUP)) {
+                        close(i, false, result);
+                        continue;
+                    }
+                    c.connected = true;
+                    result.connectNs.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - c.started).count());
+                }
+
+                if (!c.shutDown && (revents & POLLWRNORM)) {
+                    uint64_t want = std::min<uint64_t>(c.size - c.sent, payloadSize - c.sent % payloadSize);
+                    if (options_.rate > 0) want = std::min<uint64_t>(want, static_cast<uint64_t>(tokens));
+                    if (want > 0) {
+                        const int n = send(c.socket, payload_.data() + c.sent % payloadSize, static_cast<int>(want), 0);
+                        if (n == SOCKET_ERROR) {
+                            if (WSAGetLastError() != WSAEWOULDBLOCK) close(i, false, result);
+                            continue;
+                        }
+                        c.sent += n;
+                        result.bytes += n;
+                        tokens -= n;
+                    }
+                    if (c.sent == c.size) {
+                        shutdown(c.socket, SD_SEND);
+                        c.shutDown = true;
+                    }
+                }
+                else if (c.shutDown && (revents & (POLLRDNORM | POLLHUP | POLLERR))) {
+                    const int n = recv(c.socket, scratch, sizeof(scratch), 0);
+                    if (n == 0) close(i, true, result);
+                    else if (n == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK) close(i, false, result);
+                }
+                else if (revents & (POLLERR | POLLHUP)) {
+                    close(i, false, result);
+                }
+            }
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        return result;
+    }
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+struct WanProfile {
+    std::chrono::microseconds delay{}; // one way, so half the round trip
+    std::chrono::microseconds jitter{};
+    double rate = 0;                   // bytes per second each way, 0 for no cap
+    uint64_t burst = 64 * 1024;        // bytes the link lets through at once after sitting idle
+    size_t queueChunks = 1024;         // in flight per direction before the sender is pushed back on (or, for udp, dropped)
+    uint32_t lossPerMille = 0;         // udp only, datagrams dropped at random
+};
+
+// token bucket for one direction of the emulated link, shared by every connection going that way
+class Pacer {
+private:
+    std::mutex mutex_;
+    const double rate_;
+    const double burst_;
+    double tokens_;
+    std::chrono::high_resolution_clock::time_point last_ = std::chrono::high_resolution_clock::now();
+public:
+    Pacer(double rate, uint64_t burst) : rate_(rate), burst_(static_cast<double>(burst)), tokens_(static_cast<double>(burst)) {}
+
+    // blocks until `bytes` may go out
+    void take(size_t bytes) {
+        if (rate_ <= 0) return;
+        std::unique_lock lock{mutex_};
+        while (true) {
+            const auto now = std::chrono::high_resolution_clock::now();
+            tokens_ = std::min(burst_, tokens_ + rate_ * std::chrono::duration<double>(now - last_).count());
+            last_ = now;
+            // a chunk bigger than the bucket goes once the bucket is full, and leaves it in debt
+            if (tokens_ >= std::min<double>(bytes, burst_)) {
+                tokens_ -= bytes;
+                return;
+            }
+            const double wait = (std::min<double>(bytes, burst_) - tokens_) / rate_;
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+            lock.lock();
+        }
+    }
+};
+
+// one direction of a proxied connection. the reader stamps every chunk with the time it may leave (delay plus
+// jitter, never before the chunk ahead of it, so the stream stays in order) and the writer holds it until then
+// and paces it to the link's rate. the queue between them is the data in flight on the emulated link; when it's
+// full the reader stops reading and tcp pushes back on the sender like it would on a real long fat pipe
+class WanLink {
+private:
+    struct Delayed {
+        Chunk data;
+        std::chrono::high_resolution_clock::time_point due;
+    };
+
+    const SOCKET from_;
+    const SOCKET to_;
+    const WanProfile& profile_;
+    Pacer& pacer_;
+    BoundedQueue<Delayed> queue_;
+    std::mt19937_64 rng_{std::random_device{}()};
+    uint64_t bytes_ = 0;
+
+    void read() {
+        char buf[64 * 1024];
+        auto lastDue = std::chrono::high_resolution_clock::now();
+        while (true) {
+            const int n = recv(from_, buf, sizeof(buf), 0);
+            auto due = std::chrono::high_resolution_clock::now() + profile_.delay;
+            if (profile_.jitter.count() > 0) {
+                due += std::chrono::microseconds{std::uniform_int_distribution<int64_t>{0, profile_.jitter.count()}(rng_)};
+            }
+            lastDue = std::max(lastDue, due);
+            // an empty chunk carries the close across, so the far end sees it as late as it would the data
+            queue_.push({Chunk(buf, buf + std::max(n, 0)), lastDue});
+            if (n <= 0) break;
+        }
+        queue_.close();
+    }
+
+    void write() {
+        while (auto chunk = queue_.pop()) {
+            std::this_thread::sleep_until(chunk->due);
+            if (chunk->data.empty()) break;
+            pacer_.take(chunk->data.size());
+            for (size_t sent = 0; sent < chunk->data.size();) {
+                const int n = send(to_, chunk->data.data() + sent, static_cast<int>(chunk->data.size() - sent), 0);
+                if (n == SOCKET_ERROR) {
+                    // the far end is gone; stop the reader and let it drain out
+                    shutdown(from_, SD_BOTH);
+                    queue_.close();
+                    while (queue_.pop()) {}
+                    return;
+                }
+                sent += n;
+                bytes_ += n;
+            }
+        }
+        shutdown(to_, SD_SEND);
+    }
+public:
+    WanLink(SOCKET from, SOCKET to, const WanProfile& profile, Pacer& pacer)
+        : from_(from), to_(to), profile_(profile), pacer_(pacer), queue_(profile.queueChunks) {}
+
+    void run() {
+        std::thread reader{[this] { read(); }};
+        write();
+        reader.join();
+    }
+
+    uint64_t bytes() const { return bytes_; }
+};
+
+// listens on `port` and relays every connection to `upstream` through a WanLink each way, so a transfer between two
+// local processes sees a long, thin or bumpy network without root or a kernel shaper
+class WanEmulator {
+private:
+    struct Relay {
+        std::thread thread;
+        std::atomic<bool> done = false;
+    };
+
+    const WanProfile profile_;
+    Pacer upPacer_;
+    Pacer downPacer_;
+    sockaddr_storage upstream_{};
+    int upstreamLen_ = 0;
+    SOCKET listener_ = INVALID_SOCKET;
+    std::vector<std::unique_ptr<Relay>> relays_; // they use the pacers, so run() doesn't return before they're done
+    std::optional<std::string> error_;
+
+    void setError(std::string msg) {
+        error_ = std::move(msg);
+    }
+
+    void relay(SOCKET client) {
+        SOCKET server = socket(upstream_.ss_family, SOCK_STREAM, IPPROTO_TCP);
+        if (server == INVALID_SOCKET || connect(server, reinterpret_cast<sockaddr*>(&upstream_), upstreamLen_) == SOCKET_ERROR) {
+            std::cerr << "couldn't reach upstream: " << WSAGetLastError() << std::endl;
+            if (server != INVALID_SOCKET) closesocket(server);
+            closesocket(client);
+            return;
+        }
+
+        WanLink up{client, server, profile_, upPacer_};
+        WanLink down{server, client, profile_, downPacer_};
+        std::thread downThread{[&] { down.run(); }};
+        up.run();
+        downThread.join();
+        closesocket(server);
+        closesocket(client);
+        std::cerr << "connection closed, " << up.bytes() << " bytes up, " << down.bytes() << " bytes down" << std::endl;
+    }
+public:
+    WanEmulator(const WanProfile& profile, uint16_t port, const std::string& host, const std::string& upstreamPort)
+        : profile_(profile), upPacer_(profile.rate, profile.burst), downPacer_(profile.rate, profile.burst) {
+        WSADATA wsaData;
+        if (int err = WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+            setError("WSAStartup failed: " + std::to_string(err));
+            return;
+        }
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+        addrinfo* found = nullptr;
+        if (getaddrinfo(host.c_str(), upstreamPort.c_str(), &hints, &found) != 0 || !found) {
+            setError("couldn't resolve " + host);
+            return;
+        }
+        std::memcpy(&upstream_, found->ai_addr, found->ai_addrlen);
+        upstreamLen_ = static_cast<int>(found->ai_addrlen);
+        freeaddrinfo(found);
+
+        listener_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (listener_ == INVALID_SOCKET
+            || bind(listener_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR
+            || listen(listener_, SOMAXCONN) == SOCKET_ERROR) {
+            setError("couldn't listen on port " + std::to_string(port));
+        }
+    }
+
+    ~WanEmulator() {
+        if (listener_ != INVALID_SOCKET) closesocket(listener_);
+        WSACleanup();
+    }
+
+    // relays connections until accept fails, then waits for the ones still open to finish
+    void run() {
+        if (error_) return;
+        while (true) {
+            SOCKET client = accept(listener_, NULL, NULL);
+            if (client == INVALID_SOCKET) {
+                setError("socket accept error");
+                break;
+            }
+            std::erase_if(relays_, [](const std::unique_ptr<Relay>& relay) {
+                if (!relay->done) return false;
+                relay->thread.join();
+                return true;
+            });
+            auto relay = std::make_unique<Relay>();
+            relay->thread = std::thread{[this, client, done = &relay->done] {
+                this->relay(client);
+                *done = true;
+            }};
+            relays_.push_back(std::move(relay));
+        }
+        for (auto& relay : relays_) relay->thread.join();
+        relays_.clear();
+    }
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+// the udp side of --wan: relays datagrams between whoever sends to `port` and `upstream` through the same delay,
+// jitter and rate cap as a WanLink. where a tcp link pushes back on the sender when its queue is full, this one drops
+// the datagram like a router would, and lossPerMille drops a share of them at random on top
+class UdpWanRelay {
+private:
+    struct Delayed {
+        Chunk data;
+        std::chrono::high_resolution_clock::time_point due;
+    };
+
+    const WanProfile profile_;
+    Pacer upPacer_;
+    Pacer downPacer_;
+    BoundedQueue<Delayed> up_;
+    BoundedQueue<Delayed> down_;
+    SOCKET clientSide_ = INVALID_SOCKET;
+    SOCKET upstreamSide_ = INVALID_SOCKET;
+    std::mutex clientMutex_;
+    sockaddr_storage client_{};
+    int clientSize_ = 0;
+    std::atomic<uint64_t> forwarded_ = 0;
+    std::atomic<uint64_t> dropped_ = 0;
+    std::atomic<int> readers_ = 2;
+    std::optional<std::string> error_;
+
+    void setError(std::string msg) {
+        error_ = std::move(msg);
+    }
+
+    void read(SOCKET from, BoundedQueue<Delayed>& queue, bool fromClient) {
+        std::mt19937_64 rng{std::random_device{}()};
+        std::vector<char> buf(64 * 1024);
+        auto lastDue = std::chrono::high_resolution_clock::now();
+        while (true) {
+            sockaddr_storage sender{};
+            int senderSize = sizeof(sender);
+            const int n = recvfrom(from, buf.data(), static_cast<int>(buf.size()), 0, reinterpret_cast<sockaddr*>(&sender), &senderSize);
+            if (n == SOCKET_ERROR) {
+                if (WSAGetLastError() == WSAECONNRESET || WSAGetLastError() == WSAEMSGSIZE) continue;
+                break;
+            }
+            if (fromClient) {
+                std::lock_guard lock{clientMutex_};
+                client_ = sender;
+                clientSize_ = senderSize;
+            }
+            if (profile_.lossPerMille && std::uniform_int_distribution<uint32_t>{0, 999}(rng) < profile_.lossPerMille) {
+                dropped_++;
+                continue;
+            }
+            auto due = std::chrono::high_resolution_clock::now() + profile_.delay;
+            if (profile_.jitter.count() > 0) {
+                due += std::chrono::microseconds{std::uniform_int_distribution<int64_t>{0, profile_.jitter.count()}(rng)};
+            }
+            lastDue = std::max(lastDue, due);
+            if (!queue.tryPush({Chunk(buf.data(), buf.data() + n), lastDue})) dropped_++;
+        }
+        queue.close();
+        readers_--;
+    }
+
+    void write(BoundedQueue<Delayed>& queue, Pacer& pacer, bool toClient) {
+        while (auto datagram = queue.pop()) {
+            std::this_thread::sleep_until(datagram->due);
+            pacer.take(datagram->data.size());
+            if (toClient) {
+                std::lock_guard lock{clientMutex_};
+                sendto(clientSide_, datagram->data.data(), static_cast<int>(datagram->data.size()), 0,
+                       reinterpret_cast<const sockaddr*>(&client_), clientSize_);
+            }
+            else {
+                send(upstreamSide_, datagram->data.data(), static_cast<int>(datagram->data.size()), 0);
+            }
+            forwarded_++;
+        }
+    }
+
+    static void ignoreResets(SOCKET socket) {
+        BOOL reportReset = FALSE;
+        DWORD returned = 0;
+        WSAIoctl(socket, SIO_UDP_CONNRESET, &reportReset, sizeof(reportReset), NULL, 0, &returned, NULL, NULL);
+    }
+public:
+    UdpWanRelay(const WanProfile& profile, uint16_t port, const std::string& host, const std::string& upstreamPort)
+        : profile_(profile)
+        , upPacer_(profile.rate, profile.burst)
+        , downPacer_(profile.rate, profile.burst)
+        , up_(profile.queueChunks)
+        , down_(profile.queueChunks) {
+        WSADATA wsaData;
+        if (int err = WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+            setError("WSAStartup failed: " + std::to_string(err));
+            return;
+        }
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        hints.ai_protocol = IPPROTO_UDP;
+        addrinfo* found = nullptr;
+        if (getaddrinfo(host.c_str(), upstreamPort.c_str(), &hints, &found) != 0 || !found) {
+            setError("couldn't resolve " + host);
+            return;
+        }
+        upstreamSide_ = socket(found->ai_family, SOCK_DGRAM, IPPROTO_UDP);
+        const bool connected = upstreamSide_ != INVALID_SOCKET
+            && connect(upstreamSide_, found->ai_addr, static_cast<int>(found->ai_addrlen)) != SOCKET_ERROR;
+        freeaddrinfo(found);
+        if (!connected) {
+            setError("couldn't reach upstream: " + std::to_string(WSAGetLastError()));
+            return;
+        }
+
+        clientSide_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (clientSide_ == INVALID_SOCKET || bind(clientSide_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR) {
+            setError("couldn't bind udp port " + std::to_string(port));
+            return;
+        }
+        int bufferSize = 16 * 1024 * 1024;
+        for (SOCKET s : {clientSide_, upstreamSide_}) {
+            ignoreResets(s);
+            setsockopt(s, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize));
+        }
+    }
+
+    ~UdpWanRelay() {
+        if (clientSide_ != INVALID_SOCKET) closesocket(clientSide_);
+        if (upstreamSide_ != INVALID_SOCKET) closesocket(upstreamSide_);
+        WSACleanup();
+    }
+
+    // relays until a socket fails, saying how much went through and how much was dropped every few seconds
+    void run() {
+        if (error_) return;
+        std::thread upReader{[this] { read(clientSide_, up_, true); }};
+        std::thread downReader{[this] { read(upstreamSide_, down_, false); }};
+        std::thread upWriter{[this] { write(up_, upPacer_, false); }};
+        std::thread downWriter{[this] { write(down_, downPacer_, true); }};
+        uint64_t lastForwarded = 0;
+        uint64_t lastDropped = 0;
+        while (readers_ == 2) {
+            std::this_thread::sleep_for(std::chrono::seconds{5});
+            if (forwarded_ == lastForwarded && dropped_ == lastDropped) continue;
+            std::cerr << forwarded_ - lastForwarded << " datagrams relayed, " << dropped_ - lastDropped << " dropped" << std::endl;
+            lastForwarded = forwarded_;
+            lastDropped = dropped_;
+        }
+
+        setError("udp relay failed: " + std::to_string(WSAGetLastError()));
+        // closing both sockets gets the other reader out of recvfrom
+        closesocket(clientSide_);
+        closesocket(upstreamSide_);
+        upReader.join();
+        downReader.join();
+        upWriter.join();
+        downWriter.join();
+        clientSide_ = upstreamSide_ = INVALID_SOCKET;
+    }
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+// how a ConnectionServer receives: a blocking recv loop on a thread per connection, or every socket non-blocking
+// under WSAPoll on one thread
+enum class ReceiveEngine { threads, poll };
+
+std::optional<ReceiveEngine> receiveEngineForName(std::string_view name) {
+    if (name == "threads") return ReceiveEngine::threads;
+    if (name == "poll") return ReceiveEngine::poll;
+    return std::nullopt;
+}
+
+const char* receiveEngineName(ReceiveEngine engine) {
+    return engine == ReceiveEngine::threads ? "threads" : "poll";
+}
+
+// accepts any number of connections and reads each to the end, throwing the data away; for seeing how a receive
+// engine holds up as connections pile up, without the pipeline in the way.
+// memory is sampled every time the number of open connections reaches a new high, so memoryPerConnection()
+// is what each extra connection cost at the busiest point
+class ConnectionServer {
+private:
+    static constexpr int bufferSize = 64 * 1024;
+
+    const ReceiveEngine engine_;
+    SOCKET listener_ = INVALID_SOCKET;
+    uint16_t port_ = 0;
+    std::thread acceptor_;
+    std::atomic<bool> stopping_ = false;
+    std::atomic<uint64_t> bytes_ = 0;
+    std::atomic<uint64_t> accepted_ = 0;
+    std::atomic<size_t> open_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable allClosed_;
+    Histogram recvSizes_; // merged in from each connection as it closes
+    size_t peakOpen_ = 0;
+    uint64_t baselineMemory_ = 0;
+    uint64_t peakMemory_ = 0;
+    std::optional<std::string> error_;
+
+    static uint64_t committedMemory() {
+        PROCESS_MEMORY_COUNTERS memory{};
+        return GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory)) ? memory.PagefileUsage : 0;
+    }
+
+    // counted open before accepted, so accepted() == n && open() == 0 means all n have really finished
+    void opened() {
+        std::lock_guard lock{mutex_};
+        const size_t open = ++open_;
+        accepted_++;
+        if (open > peakOpen_) {
+            peakOpen_ = open;
+            peakMemory_ = committedMemory();
+        }
+    }
+
+    void closed(const Histogram& sizes) {
+        std::lock_guard lock{mutex_};
+        recvSizes_.merge(sizes);
+        if (--open_ == 0) allClosed_.notify_all();
+    }
+
+    void receiveOn(SOCKET socket) {
+        std::vector<char> buf(bufferSize);
+        Histogram sizes;
+        int n;
+        while ((n = recv(socket, buf.data(), bufferSize, 0)) > 0) {
+            bytes_ += n;
+            sizes.record(n);
+        }
+        closesocket(socket);
+        closed(sizes);
+    }
+
+    void acceptThreads() {
+        while (!stopping_) {
+            SOCKET socket = accept(listener_, NULL, NULL);
+            if (socket == INVALID_SOCKET) break;
+            opened();
+            std::thread{[this, socket] { receiveOn(socket); }}.detach();
+        }
+    }
+
+    void pollAll() {
+        std::vector<WSAPOLLFD> polls{{listener_, POLLRDNORM, 0}};
+        std::vector<char> buf(bufferSize);
+        Histogram sizes;
+        while (!stopping_) {
+            if (WSAPoll(polls.data(), static_cast<ULONG>(polls.size()), 100) == SOCKET_ERROR) break;
+            for (size_t i = polls.size(); i-- > 1;) {
+                if (polls[i].revents == 0) continue;
+                const int n = recv(polls[i].fd, buf.data(), bufferSize, 0);
+                if (n > 0) {
+                    bytes_ += n;
+                    sizes.record(n);
+                    continue;
+                }
+                if (n == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) continue;
+                closesocket(polls[i].fd);
+                polls[i] = polls.back();
+                polls.pop_back();
+                closed({});
+            }
+            if (polls[0].revents & POLLRDNORM) {
+                SOCKET socket = accept(listener_, NULL, NULL);
+                if (socket != INVALID_SOCKET) {
+                    ULONG nonBlocking = 1;
+                    ioctlsocket(socket, FIONBIO, &nonBlocking);
+                    polls.push_back({socket, POLLRDNORM, 0});
+                    opened();
+                }
+            }
+        }
+        for (size_t i = 1; i < polls.size(); i++) {
+            closesocket(polls[i].fd);
+            closed({});
+        }
+        std::lock_guard lock{mutex_};
+        recvSizes_.merge(sizes);
+    }
+public:
+    // port 0 picks a free one; `loopbackOnly` keeps it off the network for benchmarks
+    ConnectionServer(ReceiveEngine engine, uint16_t port, bool loopbackOnly) : engine_(engine) {
+        listener_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+        int len = sizeof(addr);
+        if (listener_ == INVALID_SOCKET
+            || bind(listener_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR
+            || listen(listener_, SOMAXCONN) == SOCKET_ERROR
+            || getsockname(listener_, reinterpret_cast<sockaddr*>(&addr), &len) == SOCKET_ERROR) {
+            error_ = "couldn't listen on port " + std::to_string(port);
+            return;
+        }
+        port_ = ntohs(addr.sin_port);
+        baselineMemory_ = committedMemory();
+        acceptor_ = std::thread([this] {
+            if (engine_ == ReceiveEngine::threads) acceptThreads();
+            else pollAll();
+        });
+    }
+
+    ~ConnectionServer() {
+        stop();
+    }
+
+    // stops accepting and waits for the connections already open to finish
+    void stop() {
+        if (!acceptor_.joinable()) return;
+        stopping_ = true;
+        closesocket(listener_);
+        acceptor_.join();
+        std::unique_lock lock{mutex_};
+        allClosed_.wait(lock, [&] { return open_ == 0; });
+    }
+
+    uint16_t port() const { return port_; }
+    uint64_t bytes() const { return bytes_; }
+    uint64_t accepted() const { return accepted_; }
+    size_t open() const { return open_; }
+
+    size_t peakOpen() {
+        std::lock_guard lock{mutex_};
+        return peakOpen_;
+    }
+
+    double memoryPerConnection() {
+        std::lock_guard lock{mutex_};
+        return peakOpen_ && peakMemory_ > baselineMemory_ ? static_cast<double>(peakMemory_ - baselineMemory_) / peakOpen_ : 0;
+    }
+
+    Histogram recvSizes() {
+        std::lock_guard lock{mutex_};
+        return recvSizes_;
+    }
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+// microbenchmarks for the pieces of the data path, each timed over the same number of bytes and reported as MiB/s,
+// `reps` samples apiece so the spread is visible
+namespace bench {
+
+struct Result {
+    std::string name;
+    std::vector<double> samples; // MiB/s
+};
+
+constexpr size_t recvSize = 4096;           // what drainSocket reads at a time
+constexpr size_t writeSize = 64 * 1024;
+constexpr size_t unbufferedSize = 1024 * 1024 * 1;
+
+volatile char blackhole; // keeps the copies from being optimized away
+
+// runs `body` `reps` times, each moving `bytes`; a body that returns false drops the benchmark
+std::optional<Result> measure(std::string name, size_t reps, uint64_t bytes, const std::function<bool()>& body) {
+    Result result{std::move(name), {}};
+    for (size_t i = 0; i < reps; i++) {
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        if (!body()) return std::nullopt;
+        const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t0).count();
+        result.samples.push_back(seconds > 0 ? bytes / seconds / 1024 / 1024 : 0);
+    }
+    return result;
+}
+
+double median(std::vector<double> samples) {
+    if (samples.empty()) return 0;
+    std::sort(samples.begin(), samples.end());
+    const size_t mid = samples.size() / 2;
+    return samples.size() % 2 ? samples[mid] : (samples[mid - 1] + samples[mid]) / 2;
+}
+
+// page aligned, for the unbuffered writes
+struct AlignedBuffer {
+    char* data;
+    size_t size;
+    explicit AlignedBuffer(size_t size) : data(static_cast<char*>(VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE))), size(size) {}
+    ~AlignedBuffer() { if (data) VirtualFree(data, 0, MEM_RELEASE); }
+};
+
+// ways of holding on to a stream that arrives recvSize bytes at a time
+void bufferBenchmarks(std::vector<Result>& results, size_t reps, uint64_t bytes, const char* source) {
+    // what StdoutSink does: one growing vector
+    if (auto r = measure("buffer/vector-append", reps, bytes, [&] {
+        std::vector<char> held;
+        held.reserve(1024 * 1024 * 1);
+        for (uint64_t done = 0; done < bytes; done += recvSize) held.insert(held.end(), source, source + recvSize);
+        blackhole = held.back();
+        return true;
+    })) results.push_back(*r);
+
+    // what the pipeline does: a fresh Chunk per recv
+    if (auto r = measure("buffer/chunk-per-recv", reps, bytes, [&] {
+        std::vector<Chunk> held;
+        for (uint64_t done = 0; done < bytes; done += recvSize) held.emplace_back(source, source + recvSize);
+        blackhole = held.back().back();
+        return true;
+    })) results.push_back(*r);
+
+    // fixed 1MiB blocks that are never moved once written
+    if (auto r = measure("buffer/arena", reps, bytes, [&] {
+        constexpr size_t blockSize = 1024 * 1024 * 1;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        size_t used = blockSize;
+        for (uint64_t done = 0; done < bytes; done += recvSize) {
+            if (used + recvSize > blockSize) {
+                blocks.push_back(std::make_unique_for_overwrite<char[]>(blockSize));
+                used = 0;
+            }
+            std::memcpy(blocks.back().get() + used, source, recvSize);
+            used += recvSize;
+        }
+        blackhole = blocks.back()[0];
+        return true;
+    })) results.push_back(*r);
+
+    // a handful of buffers handed back as soon as they're consumed, so nothing is allocated after warm up
+    if (auto r = measure("buffer/pool", reps, bytes, [&] {
+        std::vector<std::unique_ptr<char[]>> free;
+        for (int i = 0; i < 64; i++) free.push_back(std::make_unique_for_overwrite<char[]>(writeSize));
+        std::unique_ptr<char[]> current;
+        size_t used = writeSize;
+        for (uint64_t done = 0; done < bytes; done += recvSize) {
+            if (used + recvSize > writeSize) {
+                if (current) {
+                    blackhole = current[0];
+                    free.push_back(std::move(current));
+                }
+                current = std::move(free.back());
+                free.pop_back();
+                used = 0;
+            }
+            std::memcpy(current.get() + used, source, recvSize);
+            used += recvSize;
+        }
+        return true;
+    })) results.push_back(*r);
+
+    for (size_t size : {size_t{4096}, size_t{64 * 1024}, size_t{1024 * 1024}}) {
+        if (auto r = measure("memcpy/" + std::to_string(size), reps, bytes, [&] {
+            std::vector<char> dest(size);
+            for (uint64_t done = 0; done < bytes; done += size) {
+                std::memcpy(dest.data(), source, size);
+                blackhole = dest[done % size];
+            }
+            return true;
+        })) results.push_back(*r);
+    }
+}
+
+// ways of getting a stream into a file; none of them flush to the disk, so this is the path into the cache
+// except for the unbuffered ones, which go around it
+void sinkBenchmarks(std::vector<Result>& results, size_t reps, uint64_t bytes, const std::string& dir, const char* source) {
+    const std::string path = dir + "\\dumpsock-bench.tmp";
+
+    if (auto r = measure("sink/fwrite", reps, bytes, [&] {
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+        std::setvbuf(file, nullptr, _IOFBF, 1024 * 1024 * 1);
+        bool ok = true;
+        for (uint64_t done = 0; done < bytes && ok; done += writeSize) ok = std::fwrite(source, 1, writeSize, file) == writeSize;
+        return std::fclose(file) == 0 && ok;
+    })) results.push_back(*r);
+
+    if (auto r = measure("sink/_write", reps, bytes, [&] {
+        const int fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+        if (fd < 0) return false;
+        bool ok = true;
+        for (uint64_t done = 0; done < bytes && ok; done += writeSize) ok = _write(fd, source, writeSize) == static_cast<int>(writeSize);
+        return _close(fd) == 0 && ok;
+    })) results.push_back(*r);
+
+    if (auto r = measure("sink/WriteFile", reps, bytes, [&] {
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        bool ok = true;
+        DWORD written;
+        for (uint64_t done = 0; done < bytes && ok; done += writeSize) ok = WriteFile(file, source, writeSize, &written, NULL) && written == writeSize;
+        return CloseHandle(file) && ok;
+    })) results.push_back(*r);
+
+    if (auto r = measure("sink/mapped", reps, bytes, [&] {
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, static_cast<DWORD>(bytes >> 32), static_cast<DWORD>(bytes), NULL);
+        char* view = mapping ? static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, bytes)) : nullptr;
+        if (view) {
+            for (uint64_t done = 0; done < bytes; done += writeSize) std::memcpy(view + done, source, writeSize);
+            UnmapViewOfFile(view);
+        }
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return view != nullptr;
+    })) results.push_back(*r);
+
+    // the O_DIRECT of windows: sector aligned writes that skip the cache
+    AlignedBuffer aligned{unbufferedSize};
+    if (aligned.data) std::memcpy(aligned.data, source, unbufferedSize);
+    if (auto r = measure("sink/unbuffered", reps, bytes, [&] {
+        if (!aligned.data) return false;
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_FLAG_NO_BUFFERING, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        bool ok = true;
+        DWORD written;
+        for (uint64_t done = 0; done < bytes && ok; done += unbufferedSize) {
+            ok = WriteFile(file, aligned.data, unbufferedSize, &written, NULL) && written == unbufferedSize;
+        }
+        return CloseHandle(file) && ok;
+    })) results.push_back(*r);
+
+    // the writev of windows: one call per run of pages, which has to be unbuffered and overlapped
+    SYSTEM_INFO system;
+    GetSystemInfo(&system);
+    const size_t page = system.dwPageSize;
+    if (auto r = measure("sink/WriteFileGather", reps, bytes, [&] {
+        if (!aligned.data) return false;
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        std::vector<FILE_SEGMENT_ELEMENT> segments(unbufferedSize / page + 1);
+        for (size_t i = 0; i + 1 < segments.size(); i++) segments[i].Buffer = aligned.data + i * page;
+        segments.back().Buffer = nullptr;
+
+        bool ok = true;
+        for (uint64_t done = 0; done < bytes && ok; done += unbufferedSize) {
+            OVERLAPPED overlapped{};
+            overlapped.Offset = static_cast<DWORD>(done);
+            overlapped.OffsetHigh = static_cast<DWORD>(done >> 32);
+            DWORD written = 0;
+            ok = WriteFileGather(file, segments.data(), unbufferedSize, NULL, &overlapped)
+                 || (GetLastError() == ERROR_IO_PENDING && GetOverlappedResult(file, &overlapped, &written, TRUE));
+        }
+        return CloseHandle(file) && ok;
+    })) results.push_back(*r);
+
+    DeleteFileA(path.c_str());
+}
+
+void writeJson(std::ostream& os, const std::vector<Result>& results, uint64_t bytes) {
+    os << "{\"bytes\": " << bytes << ", \"unit\": \"MiB/s\", \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        os << (i ? "," : "") << "\n  {\"name\": \"" << results[i].name << "\", \"median\": " << median(results[i].samples) << ", \"samples\": [";
+        for (size_t j = 0; j < results[i].samples.size(); j++) os << (j ? ", " : "") << results[i].samples[j];
+        os << "]}";
+    }
+    os << "\n]}" << std::endl;
+}
+
+// reads back what writeJson wrote; just enough json for that
+std::optional<std::vector<Result>> readJson(const char* path) {
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file) return std::nullopt;
+    std::string text;
+    char buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), file)) > 0) text.append(buf, n);
+    std::fclose(file);
+
+    std::vector<Result> results;
+    constexpr std::string_view nameKey = "\"name\": \"";
+    constexpr std::string_view samplesKey = "\"samples\": [";
+    for (size_t at = text.find(nameKey); at != std::string::npos; at = text.find(nameKey, at)) {
+        at += nameKey.size();
+        const size_t nameEnd = text.find('"', at);
+        const size_t samples = text.find(samplesKey, at);
+        const size_t samplesEnd = samples == std::string::npos ? std::string::npos : text.find(']', samples);
+        if (nameEnd == std::string::npos || samplesEnd == std::string::npos) return std::nullopt;
+
+        Result result{text.substr(at, nameEnd - at), {}};
+        const char* p = text.data() + samples + samplesKey.size();
+        const char* end = text.data() + samplesEnd;
+        while (p < end) {
+            double value;
+            auto [next, ec] = std::from_chars(p, end, value);
+            if (ec != std::errc{}) return std::nullopt;
+            result.samples.push_back(value);
+            p = next;
+            while (p < end && (*p == ',' || *p == ' ')) p++;
+        }
+        results.push_back(std::move(result));
+        at = samplesEnd;
+    }
+    return results;
+}
+
+struct Summary {
+    double mean = 0;
+    double variance = 0; // sample variance
+    size_t n = 0;
+};
+
+Summary summarize(const std::vector<double>& samples) {
+    Summary s;
+    s.n = samples.size();
+    for (double x : samples) s.mean += x;
+    if (s.n) s.mean /= s.n;
+    for (double x : samples) s.variance += (x - s.mean) * (x - s.mean);
+    if (s.n > 1) s.variance /= s.n - 1;
+    return s;
+}
+
+// two sided 95% critical value of student's t
+double tCritical(double df) {
+    static constexpr double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+    if (df < 1) return table[0];
+    if (df > 30) return 1.96;
+    return table[static_cast<size_t>(df) - 1];
+}
+
+// welch's t-test of every benchmark in `current` against the same one in `baseline`. a benchmark regressed if it's
+// more than `threshold` percent slower and the 95% interval of the difference doesn't reach zero, so one noisy
+// repetition doesn't fail a run. returns how many regressed
+size_t compare(std::ostream& os, const std::vector<Result>& baseline, const std::vector<Result>& current, double threshold) {
+    size_t regressions = 0;
+    for (const Result& now : current) {
+        auto before = std::find_if(baseline.begin(), baseline.end(), [&](const Result& r) { return r.name == now.name; });
+        if (before == baseline.end()) {
+            os << "  " << now.name << ": not in the baseline" << std::endl;
+            continue;
+        }
+
+        const Summary a = summarize(before->samples);
+        const Summary b = summarize(now.samples);
+        if (a.n < 2 || b.n < 2 || a.mean <= 0) {
+            os << "  " << now.name << ": needs at least 2 repetitions on both sides" << std::endl;
+            continue;
+        }
+        const double va = a.variance / a.n;
+        const double vb = b.variance / b.n;
+        const double se = std::sqrt(va + vb);
+        const double df = se > 0 ? (va + vb) * (va + vb) / (va * va / (a.n - 1) + vb * vb / (b.n - 1)) : a.n + b.n - 2.0;
+        const double margin = tCritical(df) * se;
+        const double diff = b.mean - a.mean;
+        const double change = diff / a.mean * 100;
+        const bool significant = std::abs(diff) > margin;
+
+        const char* verdict = "same";
+        if (significant && change < -threshold) {
+            verdict = "REGRESSION";
+            regressions++;
+        }
+        else if (significant && change > threshold) {
+            verdict = "faster";
+        }
+        os << "  " << now.name << ": " << a.mean << " -> " << b.mean << " MiB/s, "
+           << (change >= 0 ? "+" : "") << change << "% (95% ci " << (diff - margin) / a.mean * 100 << "% to "
+           << (diff + margin) / a.mean * 100 << "%), " << verdict << std::endl;
+    }
+    return regressions;
+}
+
+}
+
+// runs a receiver as its own process and times one loopback transfer into it, from connect until the receiver has
+// exited, with the cpu time of everything it started (a job object catches pipelines run through cmd)
+class ReceiverRun {
+private:
+    std::optional<std::string> error_;
+
+    void setError(std::string msg) {
+        error_ = std::move(msg);
+    }
+
+    // retries while the receiver is still starting up
+    SOCKET connectLoopback(uint16_t port) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        const auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+        while (std::chrono::steady_clock::now() < giveUp) {
+            SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (s == INVALID_SOCKET) break;
+            if (connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return s;
+            closesocket(s);
+            std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        }
+        return INVALID_SOCKET;
+    }
+public:
+    double seconds = 0;
+    double cpuSeconds = 0;
+
+    ReceiverRun(const std::string& commandLine, uint16_t port, uint64_t bytes, const char* payload, size_t payloadSize) {
+        SECURITY_ATTRIBUTES inherit{sizeof(SECURITY_ATTRIBUTES), NULL, TRUE};
+        HANDLE nul = CreateFileA("NUL", GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, &inherit, OPEN_EXISTING, 0, NULL);
+        HANDLE job = CreateJobObjectA(NULL, NULL);
+        STARTUPINFOA startup{};
+        startup.cb = sizeof(startup);
+        startup.dwFlags = STARTF_USESTDHANDLES;
+        startup.hStdInput = nul;
+        startup.hStdOutput = nul;
+        startup.hStdError = nul;
+        PROCESS_INFORMATION process{};
+        std::string mutableCommand = commandLine;
+        if (nul == INVALID_HANDLE_VALUE || !job
+            || !CreateProcessA(NULL, mutableCommand.data(), NULL, NULL, TRUE, CREATE_SUSPENDED, NULL, NULL, &startup, &process)) {
+            setError("couldn't start " + commandLine);
+            if (nul != INVALID_HANDLE_VALUE) CloseHandle(nul);
+            if (job) CloseHandle(job);
+            return;
+        }
+        AssignProcessToJobObject(job, process.hProcess);
+        ResumeThread(process.hThread);
+
+        SOCKET s = connectLoopback(port);
+        if (s == INVALID_SOCKET) {
+            setError("couldn't connect");
+        }
+        else {
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (uint64_t sent = 0; sent < bytes;) {
+                const int n = send(s, payload + sent % payloadSize, static_cast<int>(std::min<uint64_t>(bytes - sent, payloadSize - sent % payloadSize)), 0);
+                if (n == SOCKET_ERROR) {
+                    setError("send failed: " + std::to_string(WSAGetLastError()));
+                    break;
+                }
+                sent += n;
+            }
+            shutdown(s, SD_SEND);
+            closesocket(s);
+            if (WaitForSingleObject(process.hProcess, 120 * 1000) != WAIT_OBJECT_0 && !error_) setError("didn't exit after the transfer");
+            seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+        TerminateProcess(process.hProcess, 1);
+        WaitForSingleObject(process.hProcess, 10 * 1000);
+
+        JOBOBJECT_BASIC_ACCOUNTING_INFORMATION accounting{};
+        if (QueryInformationJobObject(job, JobObjectBasicAccountingInformation, &accounting, sizeof(accounting), NULL)) {
+            cpuSeconds = (accounting.TotalUserTime.QuadPart + accounting.TotalKernelTime.QuadPart) / 1e7;
+        }
+        CloseHandle(process.hThread);
+        CloseHandle(process.hProcess);
+        CloseHandle(job);
+        CloseHandle(nul);
+    }
+
+    const std::optional<std::string>& error() const { return error_; }
+};
+
+// keeps a server busy with the mix a long running receiver actually sees: short transfers, long ones, senders that
+// reset half way and senders that connect and go quiet. `threads` blocking senders, each picking a kind at random
+// every time round
+class SoakDriver {
+private:
+    enum Kind { shortTransfer, longTransfer, aborted, stalled, kindCount };
+
+    const uint16_t port_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> stopping_ = false;
+    std::atomic<uint64_t> bytes_ = 0;
+    std::array<std::atomic<uint64_t>, kindCount> counts_{};
+    std::atomic<uint64_t> failures_ = 0;
+    std::vector<char> payload_;
+
+    bool sendAll(SOCKET s, uint64_t bytes) {
+        for (uint64_t sent = 0; sent < bytes && !stopping_;) {
+            const size_t at = sent % payload_.size();
+            const int n = send(s, payload_.data() + at, static_cast<int>(std::min<uint64_t>(bytes - sent, payload_.size() - at)), 0);
+            if (n == SOCKET_ERROR) return false;
+            sent += n;
+            bytes_ += n;
+        }
+        return true;
+    }
+
+    // waits for the receiver to close its end after ours
+    static void drain(SOCKET s) {
+        char buf[256];
+        while (recv(s, buf, sizeof(buf), 0) > 0) {}
+    }
+
+    void run(uint64_t seed) {
+        std::mt19937_64 rng{seed};
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port_);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        while (!stopping_) {
+            const Kind kind = static_cast<Kind>(std::uniform_int_distribution<int>{0, kindCount - 1}(rng));
+            SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (s == INVALID_SOCKET || connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR) {
+                if (s != INVALID_SOCKET) closesocket(s);
+                failures_++;
+                std::this_thread::sleep_for(std::chrono::milliseconds{100});
+                continue;
+            }
+
+            bool ok = true;
+            switch (kind) {
+                case shortTransfer:
+                    ok = sendAll(s, std::uniform_int_distribution<uint64_t>{1, 64 * 1024}(rng));
+                    shutdown(s, SD_SEND);
+                    drain(s);
+                    break;
+                case longTransfer:
+                    ok = sendAll(s, std::uniform_int_distribution<uint64_t>{16, 64}(rng) * 1024 * 1024);
+                    shutdown(s, SD_SEND);
+                    drain(s);
+                    break;
+                case aborted: {
+                    ok = sendAll(s, std::uniform_int_distribution<uint64_t>{0, 1024 * 1024}(rng));
+                    // zero linger turns the close into a reset
+                    linger reset{1, 0};
+                    setsockopt(s, SOL_SOCKET, SO_LINGER, reinterpret_cast<const char*>(&reset), sizeof(reset));
+                    break;
+                }
+                case stalled:
+                    ok = sendAll(s, 1024);
+                    for (int i = std::uniform_int_distribution<int>{10, 50}(rng); i > 0 && !stopping_; i--) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+                    }
+                    break;
+                default:
+                    break;
+            }
+            closesocket(s);
+            counts_[kind]++;
+            if (!ok) failures_++;
+        }
+    }
+public:
+    SoakDriver(uint16_t port, size_t threads) : port_(port), payload_(1024 * 1024 * 1) {
+        for (size_t i = 0; i < payload_.size(); i++) payload_[i] = static_cast<char>(i * 131 + (i >> 12));
+        std::random_device seeds;
+        for (size_t i = 0; i < threads; i++) {
+            threads_.emplace_back([this, seed = seeds()] { run(seed); });
+        }
+    }
+
+    ~SoakDriver() {
+        stop();
+    }
+
+    void stop() {
+        stopping_ = true;
+        for (auto& thread : threads_) {
+            if (thread.joinable()) thread.join();
+        }
+    }
+
+    uint64_t bytes() const { return bytes_; }
+    uint64_t failures() const { return failures_; }
+
+    std::string mix() const {
+        return std::to_string(counts_[shortTransfer]) + " short, " + std::to_string(counts_[longTransfer]) + " long, "
+             + std::to_string(counts_[aborted]) + " aborted, " + std::to_string(counts_[stalled]) + " stalled";
+    }
+};
+
+// one soak sample: what the process is holding at a point in time
+struct SoakSample {
+    double minutes;
+    uint64_t workingSet;
+    uint64_t committed;
+    uint64_t handles;
+    size_t open;
+    double MiBps;
+};
+
+// memory or handles "grew without bound" if the last quarter of the run sits clearly above the second quarter;
+// the first quarter is warm up. comparing averages rides out the sawtooth of connections coming and going
+std::optional<std::string> soakGrowth(const std::vector<SoakSample>& samples) {
+    if (samples.size() < 8) return std::nullopt;
+    const size_t quarter = samples.size() / 4;
+    auto average = [&](size_t from, auto field) {
+        double sum = 0;
+        for (size_t i = from; i < from + quarter; i++) sum += static_cast<double>(samples[i].*field);
+        return sum / quarter;
+    };
+    const double committedBefore = average(quarter, &SoakSample::committed);
+    const double committedAfter = average(samples.size() - quarter, &SoakSample::committed);
+    if (committedAfter > committedBefore * 1.1 + 16 * 1024 * 1024) {
+        return "committed memory grew from " + std::to_string(static_cast<uint64_t>(committedBefore / 1024 / 1024)) + "MiB to "
+             + std::to_string(static_cast<uint64_t>(committedAfter / 1024 / 1024)) + "MiB";
+    }
+    const double handlesBefore = average(quarter, &SoakSample::handles);
+    const double handlesAfter = average(samples.size() - quarter, &SoakSample::handles);
+    if (handlesAfter > handlesBefore * 1.1 + 64) {
+        return "handles grew from " + std::to_string(static_cast<uint64_t>(handlesBefore)) + " to "
+             + std::to_string(static_cast<uint64_t>(handlesAfter));
+    }
+    return std::nullopt;
+}
+
+// keeps the trace provider registered for the whole run, whichever mode returns
+struct TraceRegistration {
+    TraceRegistration() { TraceLoggingRegister(traceProvider); }
+    ~TraceRegistration() { TraceLoggingUnregister(traceProvider); }
+};
+
+void UNUSED(const auto& v) {
+    v;
+}
+
+void usage() {
+    std::cerr << "usage: dumpsock [--workers N] [--stage NAME]... [--sink SINK] [--trace FILE] [--counters] [--tcp-info MS] [--rx-timestamps] [--tune]" << std::endl;
+    std::cerr << "                [--read-engine auto|recv|overlapped|rio] [--reprobe] [--udp]" << std::endl;
+    std::cerr << "  --workers N    threads for block parallel stages, defaults to one per core" << std::endl;
+    std::cerr << "  --stage NAME   append a transform between receive and output; stages run in the order given" << std::endl;
+    std::cerr << "                 available: crc32, strip-cr, compress[:xpress|xpress-huff|lzms|mszip], encrypt:KEYFILE, merkle:TREEFILE" << std::endl;
+    std::cerr << "  --sink SINK    where the output goes: stdout (default), or ec:K:M:DIR,DIR,... for k data + m parity" << std::endl;
+    std::cerr << "                 reed-solomon shards, one per directory, or s3:http[s]://host[:port]/bucket/key to upload" << std::endl;
+    std::cerr << "                 while receiving (credentials from AWS_ACCESS_KEY_ID, AWS_SECRET_ACCESS_KEY, AWS_REGION)" << std::endl;
+    std::cerr << "  --trace FILE   record a timeline of the transfer and write it to FILE as chrome trace json" << std::endl;
+    std::cerr << "  --counters     report cycles, cpu time and page faults per GB for the receive and the output" << std::endl;
+    std::cerr << "  --tcp-info MS  sample the connection's rtt, windows and retransmits every MS milliseconds" << std::endl;
+    std::cerr << "  --rx-timestamps  with --udp, measure kernel to user delivery latency from the stack's receive timestamps" << std::endl;
+    std::cerr << "  --tune         hill climb recv size, batching, blocks in flight and compression method while receiving" << std::endl;
+    std::cerr << "  --read-engine  how to read the socket; auto (default) uses the fastest that probed as working on this" << std::endl;
+    std::cerr << "                 machine, with the results kept in %LOCALAPPDATA%\\dumpsock\\engines.txt; --reprobe redoes them" << std::endl;
+    std::cerr << "  --udp          receive from dumpsock --udp-send over reliable udp on port 9999 instead of tcp" << std::endl;
+    std::cerr << "       dumpsock --extract FILE OFFSET LENGTH" << std::endl;
+    std::cerr << "  decompress a byte range of a capture written with --stage compress to stdout" << std::endl;
+    std::cerr << "       dumpsock --genkey KEYFILE" << std::endl;
+    std::cerr << "  write a new random master key for --stage encrypt" << std::endl;
+    std::cerr << "       dumpsock --decrypt KEYFILE FILE" << std::endl;
+    std::cerr << "  verify and decrypt a capture written with --stage encrypt to stdout" << std::endl;
+    std::cerr << "       dumpsock --merkle-diff TREEFILE TREEFILE" << std::endl;
+    std::cerr << "  list the byte ranges whose blocks differ between two merkle trees" << std::endl;
+    std::cerr << "       dumpsock --merkle-verify TREEFILE FILE OFFSET LENGTH" << std::endl;
+    std::cerr << "  check the blocks of FILE covering a byte range against a merkle tree" << std::endl;
+    std::cerr << "       dumpsock --ec-restore SHARDFILE..." << std::endl;
+    std::cerr << "  rebuild an erasure coded capture to stdout from any k of its shard files" << std::endl;
+    std::cerr << "       dumpsock --load HOST:PORT [--connections N] [--total N] [--size N|MIN-MAX|exp:MEAN] [--rate MiB/s] [--burst BYTES]" << std::endl;
+    std::cerr << "  generate load: N connections at once (100), each sending one payload, until --total have gone;" << std::endl;
+    std::cerr << "  reports throughput and connect and completion latency" << std::endl;
+    std::cerr << "       dumpsock --udp-send HOST:PORT [--bytes N] [--rate MiB/s] [--fec K:M] [--one-way]" << std::endl;
+    std::cerr << "  send stdin, or N filler bytes, to a --udp receiver, pacing to what the path delivers up to --rate;" << std::endl;
+    std::cerr << "  --fec adds M reed-solomon parity packets per K so losses are rebuilt without resending, and" << std::endl;
+    std::cerr << "  --one-way sends at --rate without listening for acks, for links with no way back" << std::endl;
+    std::cerr << "       dumpsock --wan PORT HOST:PORT [--udp] [--rtt MS] [--jitter MS] [--rate MiB/s] [--burst BYTES] [--queue CHUNKS] [--loss PERMILLE]" << std::endl;
+    std::cerr << "  relay connections (or with --udp, datagrams) on PORT to HOST:PORT as if over a slower, longer network;" << std::endl;
+    std::cerr << "  --loss drops that many udp datagrams in a thousand at random" << std::endl;
+    std::cerr << "       dumpsock --serve PORT [--engine threads|poll] [--exit-after N]" << std::endl;
+    std::cerr << "  accept any number of senders and discard what they send, for load testing" << std::endl;
+    std::cerr << "       dumpsock --scale [--engine threads|poll] [--max N] [--bytes N]" << std::endl;
+    std::cerr << "  ramp loopback senders from 1 to N (10000) per receive engine and tabulate how each step holds up" << std::endl;
+    std::cerr << "       dumpsock --bench [--bytes N] [--reps N] [--dir DIR] [--save FILE] [--compare FILE] [--threshold PERCENT]" << std::endl;
+    std::cerr << "  microbenchmark buffering, memcpy and file writing strategies, results as json on stdout;" << std::endl;
+    std::cerr << "  --save keeps them as a baseline, --compare fails on anything significantly slower than one" << std::endl;
+    std::cerr << "       dumpsock --versus [--bytes N] [--reps N]" << std::endl;
+    std::cerr << "  time the same loopback transfer into dumpsock and into nc, socat and nc | pv where installed" << std::endl;
+    std::cerr << "       dumpsock --soak [--minutes N] [--interval SECONDS] [--senders N] [--engine threads|poll]" << std::endl;
+    std::cerr << "  run the server under mixed traffic for a long time, failing if memory or handles keep growing" << std::endl;
+}
+
+int ecRestore(const std::vector<const char*>& paths) {
+    ErasureCapture capture{};
+    capture.open(paths);
+    capture.restore(stdout);
+    if (capture.error()) {
+        std::cerr << *capture.error() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// prints runs of consecutive blocks as byte ranges, one per line
+void printBlockRanges(const std::vector<uint64_t>& blocks, uint64_t blockSize, uint64_t size) {
+    for (size_t i = 0; i < blocks.size();) {
+        size_t j = i;
+        while (j + 1 < blocks.size() && blocks[j + 1] == blocks[j] + 1) j++;
+        const uint64_t from = blocks[i] * blockSize;
+        const uint64_t to = std::max(from, std::min(size, (blocks[j] + 1) * blockSize));
+        std::cout << "blocks " << blocks[i] << "-" << blocks[j] << " bytes " << from << "-" << to << std::endl;
+        i = j + 1;
+    }
+}
+
+int merkleDiff(const char* pathA, const char* pathB) {
+    MerkleTree a{};
+    MerkleTree b{};
+    a.load(pathA);
+    b.load(pathB);
+    for (const auto* tree : {&a, &b}) {
+        if (tree->error()) {
+            std::cerr << *tree->error() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (a.blockSize() != b.blockSize()) {
+        std::cerr << "trees use different block sizes" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto blocks = a.mismatchedLeaves(b);
+    printBlockRanges(blocks, a.blockSize(), std::max(a.size(), b.size()));
+    return blocks.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int merkleVerify(const char* treePath, const char* path, std::string_view offsetArg, std::string_view lengthArg) {
+    const auto offset = parseCount(offsetArg);
+    const auto length = parseCount(lengthArg);
+    if (!offset || !length) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    MerkleTree tree{};
+    tree.load(treePath);
+    if (tree.error()) {
+        std::cerr << *tree.error() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        std::cerr << "couldn't open " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const uint64_t end = std::min(tree.size(), *offset + std::min(*length, tree.size()));
+    std::vector<uint64_t> bad;
+    Chunk block(tree.blockSize());
+    for (uint64_t i = *offset / tree.blockSize(); i * tree.blockSize() < end; i++) {
+        const uint64_t start = i * tree.blockSize();
+        const size_t size = static_cast<size_t>(std::min<uint64_t>(tree.blockSize(), tree.size() - start));
+        const bool read = _fseeki64(file, static_cast<long long>(start), SEEK_SET) == 0 && std::fread(block.data(), 1, size, file) == size;
+        const auto leaf = read ? MerkleTree::hashLeaf({block.data(), size}) : std::nullopt;
+        if (!leaf || *leaf != tree.leaf(i)) bad.push_back(i);
+    }
+    std::fclose(file);
+
+    std::cerr << "root " << toHex(tree.root()) << std::endl;
+    printBlockRanges(bad, tree.blockSize(), tree.size());
+    return bad.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int genkey(const char* path) {
+    std::array<uint8_t, encrypted::keySize> key;
+    const NTSTATUS status = BCryptGenRandom(nullptr, key.data(), static_cast<ULONG>(key.size()), BCRYPT_USE_SYSTEM_PREFERRED_RNG);
+    if (!BCRYPT_SUCCESS(status)) {
+        std::cerr << "BCryptGenRandom failed: " << status << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::FILE* file = std::fopen(path, "wbx"); // never clobber an existing key
+    if (!file || std::fwrite(key.data(), 1, key.size(), file) != key.size() || std::fclose(file) != 0) {
+        std::cerr << "couldn't write a new key to " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int decrypt(const char* keyFile, const char* path) {
+    EncryptedCapture capture{};
+    capture.decrypt(keyFile, path, stdout);
+    if (capture.error()) {
+        std::cerr << *capture.error() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// --load HOST:PORT [--connections N] [--total N] [--size SIZES] [--rate MiB/s] [--burst BYTES]
+int load(int argc, char** argv) {
+    LoadOptions options;
+    const std::string_view target = argv[2];
+    const size_t colon = target.rfind(':');
+    if (colon == std::string_view::npos) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    options.host = target.substr(0, colon);
+    options.port = target.substr(colon + 1);
+
+    for (int i = 3; i + 1 < argc; i += 2) {
+        const std::string_view arg = argv[i];
+        const std::string_view value = argv[i + 1];
+        std::optional<uint64_t> count = parseCount(value);
+        if (arg == "--size") {
+            auto sizes = SizeDistribution::parse(value);
+            if (!sizes) {
+                usage();
+                return EXIT_FAILURE;
+            }
+            options.sizes = *sizes;
+            continue;
+        }
+        if (!count) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        if (arg == "--connections" && *count > 0) options.connections = *count;
+        else if (arg == "--total") options.total = *count;
+        else if (arg == "--rate") options.rate = *count * 1024.0 * 1024.0;
+        else if (arg == "--burst" && *count > 0) options.burst = *count;
+        else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if ((argc - 3) % 2 != 0) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    LoadGenerator generator{options};
+    const LoadResult result = generator.run();
+    if (generator.error()) {
+        std::cerr << *generator.error() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << result.completed << " connections completed, " << result.failed << " failed, "
+              << result.bytes << " bytes in " << result.seconds << "s for "
+              << (result.seconds > 0 ? result.bytes / result.seconds / 1024 / 1024 : 0) << " MiB/s" << std::endl;
+    std::cerr << "  connect ";
+    result.connectNs.describe(std::cerr, 1e6, "ms");
+    std::cerr << std::endl << "  completion ";
+    result.completionNs.describe(std::cerr, 1e6, "ms");
+    std::cerr << std::endl << "  per connection ";
+    result.connectionBps.describe(std::cerr, 1024 * 1024, "MiB/s");
+    std::cerr << std::endl;
+    return result.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// --udp-send HOST:PORT [--bytes N] [--rate MiB/s] [--fec K:M] [--one-way]: sends stdin, or N filler bytes, to a
+// dumpsock --udp receiver
+int udpSend(int argc, char** argv) {
+    const std::string_view target = argv[2];
+    const size_t colon = target.rfind(':');
+    std::optional<uint64_t> bytes;
+    double rate = 0;
+    std::optional<uint64_t> fecK;
+    std::optional<uint64_t> fecM;
+    bool oneWay = false;
+    bool ok = colon != std::string_view::npos;
+    for (int i = 3; ok && i < argc; i++) {
+        const std::string_view arg = argv[i];
+        if (arg == "--one-way") {
+            oneWay = true;
+            continue;
+        }
+        if (i + 1 == argc) {
+            ok = false;
+            break;
+        }
+        const std::string_view value = argv[++i];
+        if (arg == "--fec") {
+            const size_t split = value.find(':');
+            fecK = parseCount(value.substr(0, split));
+            fecM = split == std::string_view::npos ? std::nullopt : parseCount(value.substr(split + 1));
+            // the cauchy rows run out at 256 packets a group
+            ok = fecK && fecM && *fecK > 0 && *fecM > 0 && *fecK + *fecM <= 255;
+            continue;
+        }
+        const auto count = parseCount(value);
+        if (arg == "--bytes") bytes = count;
+        else if (arg == "--rate" && count) rate = *count * 1024.0 * 1024.0;
+        else ok = false;
+        ok = ok && count;
+    }
+    // with nothing coming back there's no delivery rate to steer by
+    if (!ok || (oneWay && rate <= 0)) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    WSADATA wsaData;
+    if (int err = WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+        std::cerr << "WSAStartup failed: " << err << std::endl;
+        return EXIT_FAILURE;
+    }
+    const std::string host{target.substr(0, colon)};
+    const std::string port{target.substr(colon + 1)};
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0 || !found) {
+        std::cerr << "couldn't resolve " << host << std::endl;
+        return EXIT_FAILURE;
+    }
+    sockaddr_storage addr{};
+    std::memcpy(&addr, found->ai_addr, found->ai_addrlen);
+    const int addrSize = static_cast<int>(found->ai_addrlen);
+    freeaddrinfo(found);
+
+    _setmode(_fileno(stdin), O_BINARY);
+    uint64_t remaining = bytes.value_or(0);
+    auto source = [&](char* out, size_t max) -> size_t {
+        if (!bytes) return std::fread(out, 1, max, stdin);
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(max, remaining));
+        for (size_t i = 0; i < n; i++) out[i] = static_cast<char>((*bytes - remaining + i) * 31);
+        remaining -= n;
+        return n;
+    };
+
+    // pacing sleeps in 1ms polls, which the default 15.6ms timer resolution would make far too coarse
+    timeBeginPeriod(1);
+    const auto start = std::chrono::high_resolution_clock::now();
+    ReliableUdpSender sender{addr, addrSize, source, rate};
+    if (fecK) sender.useFec(*fecK, *fecM);
+    if (oneWay) sender.oneWay();
+    sender.run();
+    const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    timeEndPeriod(1);
+    if (sender.error()) {
+        std::cerr << *sender.error() << std::endl;
+        return EXIT_FAILURE;
+    }
+    sender.report(std::cerr, seconds);
+    WSACleanup();
+    return EXIT_SUCCESS;
+}
+
+// --wan PORT HOST:PORT [--udp] [--rtt MS] [--jitter MS] [--rate MiB/s] [--burst BYTES] [--queue CHUNKS] [--loss PERMILLE]
+int wan(int argc, char** argv) {
+    const auto port = parseCount(argv[2]);
+    const std::string_view target = argv[3];
+    const size_t colon = target.rfind(':');
+    const bool udp = argc >= 5 && std::string_view{argv[4]} == "--udp";
+    const int first = udp ? 5 : 4;
+    if (!port || *port > 0xFFFF || colon == std::string_view::npos || (argc - first) % 2 != 0) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    WanProfile profile;
+    bool queueGiven = false;
+    for (int i = first; i + 1 < argc; i += 2) {
+        const std::string_view arg = argv[i];
+        const auto count = parseCount(argv[i + 1]);
+        if (!count) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        if (arg == "--rtt") profile.delay = std::chrono::microseconds{*count * 1000 / 2};
+        else if (arg == "--jitter") profile.jitter = std::chrono::microseconds{*count * 1000};
+        else if (arg == "--rate") profile.rate = *count * 1024.0 * 1024.0;
+        else if (arg == "--burst" && *count > 0) profile.burst = *count;
+        else if (arg == "--queue" && *count > 0) {
+            profile.queueChunks = *count;
+            queueGiven = true;
+        }
+        else if (arg == "--loss" && udp && *count <= 1000) profile.lossPerMille = static_cast<uint32_t>(*count);
+        else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (udp) {
+        // a queue of datagrams rather than of recv sized chunks, so it needs to be deeper to hold the same bytes
+        if (!queueGiven) profile.queueChunks = 65536;
+        UdpWanRelay relay{profile, static_cast<uint16_t>(*port), std::string{target.substr(0, colon)}, std::string{target.substr(colon + 1)}};
+        relay.run();
+        std::cerr << *relay.error() << std::endl;
+        return EXIT_FAILURE;
+    }
+    WanEmulator emulator{profile, static_cast<uint16_t>(*port), std::string{target.substr(0, colon)}, std::string{target.substr(colon + 1)}};
+    emulator.run();
+    std::cerr << *emulator.error() << std::endl;
+    return EXIT_FAILURE;
+}
+
+// --serve PORT [--engine threads|poll] [--exit-after N]: takes any number of senders and discards what they send,
+// printing what it's seeing every few seconds. with --exit-after, quits once N connections have come and gone
+int serve(int argc, char** argv) {
+    const auto port = parseCount(argv[2]);
+    std::optional<ReceiveEngine> engine = ReceiveEngine::threads;
+    std::optional<uint64_t> exitAfter;
+    bool ok = port && *port <= 0xFFFF && argc % 2 == 1;
+    for (int i = 3; ok && i + 1 < argc; i += 2) {
+        const std::string_view arg = argv[i];
+        if (arg == "--engine") engine = receiveEngineForName(argv[i + 1]);
+        else if (arg == "--exit-after") exitAfter = parseCount(argv[i + 1]);
+        else ok = false;
+        ok = ok && engine && (arg != "--exit-after" || exitAfter);
+    }
+    if (!ok) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    WSADATA wsaData;
+    if (int err = WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+        std::cerr << "WSAStartup failed: " << err << std::endl;
+        return EXIT_FAILURE;
+    }
+    ConnectionServer server{*engine, static_cast<uint16_t>(*port), false};
+    if (server.error()) {
+        std::cerr << *server.error() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    constexpr auto interval = std::chrono::seconds{5};
+    constexpr auto tick = std::chrono::milliseconds{100};
+    uint64_t lastBytes = 0;
+    auto lastReport = std::chrono::steady_clock::now();
+    while (!exitAfter || server.accepted() < *exitAfter || server.open() > 0) {
+        std::this_thread::sleep_for(tick);
+        if (std::chrono::steady_clock::now() - lastReport < interval) continue;
+        lastReport = std::chrono::steady_clock::now();
+        const uint64_t bytes = server.bytes();
+        std::cerr << server.open() << " open, " << server.accepted() << " accepted, "
+                  << (bytes - lastBytes) / std::chrono::duration<double>(interval).count() / 1024 / 1024 << " MiB/s, recv size ";
+        server.recvSizes().describe(std::cerr, 1, "B");
+        std::cerr << std::endl;
+        lastBytes = bytes;
+    }
+    server.stop();
+    std::cerr << server.accepted() << " connections, " << server.bytes() << " bytes" << std::endl;
+    WSACleanup();
+    return EXIT_SUCCESS;
+}
+
+// --scale [--engine threads|poll] [--max N] [--bytes N]: for each engine, ramps 1, 10, 100... up to N concurrent
+// loopback senders splitting --bytes between them, and prints throughput, fairness, memory per connection and cpu per
+// GB at each step so a cliff shows up as a row that falls off. both ends run in this process, so memory and cpu
+// include the senders' share; compare rows, not absolutes
+int scale(int argc, char** argv) {
+    std::vector<ReceiveEngine> engines{ReceiveEngine::threads, ReceiveEngine::poll};
+    uint64_t maxConnections = 10000;
+    uint64_t bytes = 256 * 1024 * 1024;
+    for (int i = 2; i < argc; i += 2) {
+        const std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        if (arg == "--engine") {
+            const auto engine = receiveEngineForName(argv[i + 1]);
+            if (!engine) {
+                usage();
+                return EXIT_FAILURE;
+            }
+            engines = {*engine};
+            continue;
+        }
+        const auto count = parseCount(argv[i + 1]);
+        if (!count || *count == 0) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        if (arg == "--max") maxConnections = *count;
+        else if (arg == "--bytes") bytes = *count;
+        else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    WSADATA wsaData;
+    if (int err = WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+        std::cerr << "WSAStartup failed: " << err << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint64_t> steps;
+    for (uint64_t n = 1; n < maxConnections; n *= 10) steps.push_back(n);
+    steps.push_back(maxConnections);
+
+    std::cout << "engine\tconnections\tMiB/s\tfairness\tKiB/conn\tMcycles/GB\tcpu ms/GB\tfailed" << std::endl;
+    for (ReceiveEngine engine : engines) {
+        for (uint64_t n : steps) {
+            ConnectionServer server{engine, 0, true};
+            if (server.error()) {
+                std::cerr << *server.error() << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            LoadOptions options;
+            options.host = "127.0.0.1";
+            options.port = std::to_string(server.port());
+            options.connections = n;
+            options.total = n;
+            options.sizes = *SizeDistribution::parse(std::to_string(std::max<uint64_t>(bytes / n, 4096)));
+
+            const CpuCounters before = CpuCounters::sample();
+            LoadGenerator generator{options};
+            const LoadResult result = generator.run();
+            server.stop();
+            const CpuCounters cpu = CpuCounters::sample() - before;
+            if (generator.error()) {
+                std::cerr << *generator.error() << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            const double gb = server.bytes() / 1e9;
+            std::cout << receiveEngineName(engine) << "\t" << n << "\t"
+                      << (result.seconds > 0 ? server.bytes() / result.seconds / 1024 / 1024 : 0) << "\t"
+                      << result.fairness() << "\t"
+                      << server.memoryPerConnection() / 1024 << "\t"
+                      << (gb > 0 ? cpu.processCycles / gb / 1e6 : 0) << "\t"
+                      << (gb > 0 ? (cpu.userTime + cpu.kernelTime) / gb / 1e4 : 0) << "\t"
+                      << result.failed << std::endl;
+        }
+    }
+    WSACleanup();
+    return EXIT_SUCCESS;
+}
+
+// --bench [--bytes N] [--reps N] [--dir DIR] [--save FILE] [--compare FILE] [--threshold PERCENT]: runs the
+// microbenchmarks and writes json to stdout, and to FILE for --save. with --compare, fails if anything regressed
+// against the baseline in FILE
+int runBenchmarks(int argc, char** argv) {
+    uint64_t bytes = 256 * 1024 * 1024;
+    size_t reps = 5;
+    std::string dir = ".";
+    const char* savePath = nullptr;
+    const char* baselinePath = nullptr;
+    double threshold = 5;
+    for (int i = 2; i < argc; i += 2) {
+        const std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        if (arg == "--dir") {
+            dir = argv[i + 1];
+            continue;
+        }
+        if (arg == "--save") {
+            savePath = argv[i + 1];
+            continue;
+        }
+        if (arg == "--compare") {
+            baselinePath = argv[i + 1];
+            continue;
+        }
+        const auto count = parseCount(argv[i + 1]);
+        if (!count || *count == 0) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        if (arg == "--bytes") bytes = *count;
+        else if (arg == "--reps") reps = *count;
+        else if (arg == "--threshold") threshold = static_cast<double>(*count);
+        else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    // whole unbuffered writes, which covers every other block size too
+    bytes = std::max<uint64_t>(bytes / bench::unbufferedSize, 1) * bench::unbufferedSize;
+
+    std::vector<char> source(bench::unbufferedSize);
+    for (size_t i = 0; i < source.size(); i++) source[i] = static_cast<char>(i * 131 + (i >> 12));
+
+    std::optional<std::vector<bench::Result>> baseline;
+    if (baselinePath) {
+        baseline = bench::readJson(baselinePath);
+        if (!baseline) {
+            std::cerr << "couldn't read a baseline from " << baselinePath << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<bench::Result> results;
+    bench::bufferBenchmarks(results, reps, bytes, source.data());
+    bench::sinkBenchmarks(results, reps, bytes, dir, source.data());
+    bench::writeJson(std::cout, results, bytes);
+
+    if (savePath) {
+        std::ofstream file{savePath};
+        bench::writeJson(file, results, bytes);
+        if (!file) {
+            std::cerr << "couldn't save the baseline to " << savePath << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (baseline) {
+        std::cerr << "against " << baselinePath << ", " << threshold << "% threshold:" << std::endl;
+        const size_t regressions = bench::compare(std::cerr, *baseline, results, threshold);
+        if (regressions) {
+            std::cerr << regressions << " regressed" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+// full path to `exe` if it's on the PATH
+std::optional<std::string> findOnPath(const char* exe) {
+    char path[MAX_PATH];
+    const DWORD length = SearchPathA(NULL, exe, NULL, MAX_PATH, path, NULL);
+    if (length == 0 || length >= MAX_PATH) return std::nullopt;
+    return std::string{path, length};
+}
+
+// --versus [--bytes N] [--reps N]: the same loopback transfer into dumpsock (its normal receive, and both --serve
+// engines) and into whichever of ncat/nc, socat and nc | pv are on the PATH, side by side
+int versus(int argc, char** argv) {
+    uint64_t bytes = 256 * 1024 * 1024;
+    size_t reps = 3;
+    for (int i = 2; i < argc; i += 2) {
+        const std::string_view arg = argv[i];
+        const auto count = i + 1 < argc ? parseCount(argv[i + 1]) : std::nullopt;
+        if (!count || *count == 0) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        if (arg == "--bytes") bytes = *count;
+        else if (arg == "--reps") reps = *count;
+        else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    constexpr uint16_t port = 9999;
+    struct Contender {
+        std::string name;
+        std::string commandLine;
+    };
+    char self[MAX_PATH];
+    GetModuleFileNameA(NULL, self, MAX_PATH);
+    const std::string quotedSelf = "\"" + std::string{self} + "\"";
+    std::vector<Contender> contenders{
+        {"dumpsock", quotedSelf},
+        {"dumpsock --serve threads", quotedSelf + " --serve 9999 --engine threads --exit-after 1"},
+        {"dumpsock --serve poll", quotedSelf + " --serve 9999 --engine poll --exit-after 1"},
+    };
+    std::optional<std::string> nc;
+    if (auto ncat = findOnPath("ncat.exe")) {
+        nc = "\"" + *ncat + "\" -l 9999";
+    }
+    else if (auto netcat = findOnPath("nc.exe")) {
+        nc = "\"" + *netcat + "\" -l -p 9999";
+    }
+    if (nc) contenders.push_back({"nc", *nc});
+    if (auto socat = findOnPath("socat.exe")) {
+        contenders.push_back({"socat", "\"" + *socat + "\" -u TCP-LISTEN:9999,reuseaddr STDOUT"});
+    }
+    if (auto pv = findOnPath("pv.exe"); pv && nc) {
+        contenders.push_back({"nc | pv", "cmd.exe /s /c \"" + *nc + " | \"" + *pv + "\" -q\""});
+    }
+
+    WSADATA wsaData;
+    if (int err = WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+        std::cerr << "WSAStartup failed: " << err << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<char> payload(1024 * 1024 * 1);
+    for (size_t i = 0; i < payload.size(); i++) payload[i] = static_cast<char>(i * 131 + (i >> 12));
+
+    std::cout << "receiver\tMiB/s\tcpu ms/GB\truns" << std::endl;
+    for (const Contender& contender : contenders) {
+        std::vector<double> throughput;
+        std::vector<double> cpu;
+        for (size_t rep = 0; rep < reps; rep++) {
+            ReceiverRun run{contender.commandLine, port, bytes, payload.data(), payload.size()};
+            if (run.error()) {
+                std::cerr << contender.name << ": " << *run.error() << std::endl;
+                continue;
+            }
+            throughput.push_back(run.seconds > 0 ? bytes / run.seconds / 1024 / 1024 : 0);
+            cpu.push_back(run.cpuSeconds * 1000 / (bytes / 1e9));
+        }
+        std::cout << contender.name << "\t" << bench::median(throughput) << "\t" << bench::median(cpu) << "\t" << throughput.size() << std::endl;
+    }
+    WSACleanup();
+    return EXIT_SUCCESS;
+}
+
+// --soak [--minutes N] [--interval SECONDS] [--senders N] [--engine threads|poll]: runs a ConnectionServer under
+// SoakDriver traffic and samples the process as it goes, failing if memory or handles keep climbing
+int soak(int argc, char** argv) {
+    uint64_t minutes = 60;
+    uint64_t interval = 10;
+    uint64_t senders = 32;
+    ReceiveEngine engine = ReceiveEngine::threads;
+    for (int i = 2; i < argc; i += 2) {
+        const std::string_view arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        if (arg == "--engine") {
+            const auto named = receiveEngineForName(argv[i + 1]);
+            if (!named) {
+                usage();
+                return EXIT_FAILURE;
+            }
+            engine = *named;
+            continue;
+        }
+        const auto count = parseCount(argv[i + 1]);
+        if (!count || *count == 0) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        if (arg == "--minutes") minutes = *count;
+        else if (arg == "--interval") interval = *count;
+        else if (arg == "--senders") senders = *count;
+        else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    WSADATA wsaData;
+    if (int err = WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+        std::cerr << "WSAStartup failed: " << err << std::endl;
+        return EXIT_FAILURE;
+    }
+    ConnectionServer server{engine, 0, true};
+    if (server.error()) {
+        std::cerr << *server.error() << std::endl;
+        return EXIT_FAILURE;
+    }
+    SoakDriver driver{server.port(), senders};
+
+    std::vector<SoakSample> samples;
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::minutes{minutes};
+    uint64_t lastBytes = 0;
+    std::cout << "minutes\tworking set MiB\tcommitted MiB\thandles\topen\tMiB/s" << std::endl;
+    while (std::chrono::steady_clock::now() < end) {
+        std::this_thread::sleep_for(std::chrono::seconds{interval});
+        PROCESS_MEMORY_COUNTERS memory{};
+        GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory));
+        DWORD handles = 0;
+        GetProcessHandleCount(GetCurrentProcess(), &handles);
+        const uint64_t bytes = server.bytes();
+        const SoakSample sample{
+            std::chrono::duration<double, std::ratio<60>>(std::chrono::steady_clock::now() - start).count(),
+            memory.WorkingSetSize, memory.PagefileUsage, handles, server.open(),
+            (bytes - lastBytes) / static_cast<double>(interval) / 1024 / 1024,
+        };
+        lastBytes = bytes;
+        samples.push_back(sample);
+        std::cout << sample.minutes << "\t" << sample.workingSet / 1024 / 1024 << "\t" << sample.committed / 1024 / 1024 << "\t"
+                  << sample.handles << "\t" << sample.open << "\t" << sample.MiBps << std::endl;
+    }
+    driver.stop();
+    server.stop();
+    WSACleanup();
+
+    std::cerr << driver.mix() << ", " << driver.failures() << " failed, " << server.accepted() << " accepted" << std::endl;
+    if (auto growth = soakGrowth(samples)) {
+        std::cerr << "FAIL: " << *growth << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cerr << "no unbounded growth in " << samples.size() << " samples" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int extract(const char* path, std::string_view offsetArg, std::string_view lengthArg) {
+    const auto offset = parseCount(offsetArg);
+    const auto length = parseCount(lengthArg);
+    if (!offset || !length) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    SeekableCapture capture{};
+    capture.open(path);
+    capture.extract(*offset, *length, stdout);
+    if (capture.error()) {
+        std::cerr << *capture.error() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+    int v = _setmode(_fileno(stdout), O_BINARY); // write to stdout in binary mode, not character mode; otherwise windows adds an 0x0D byte for every 0x0A byte
+    UNUSED(v);
+
+    TraceRegistration traceRegistration{};
+
+    if (argc == 5 && std::string_view{argv[1]} == "--extract") {
+        return extract(argv[2], argv[3], argv[4]);
+    }
+    if (argc == 3 && std::string_view{argv[1]} == "--genkey") {
+        return genkey(argv[2]);
+    }
+    if (argc == 4 && std::string_view{argv[1]} == "--decrypt") {
+        return decrypt(argv[2], argv[3]);
+    }
+    if (argc == 4 && std::string_view{argv[1]} == "--merkle-diff") {
+        return merkleDiff(argv[2], argv[3]);
+    }
+    if (argc == 6 && std::string_view{argv[1]} == "--merkle-verify") {
+        return merkleVerify(argv[2], argv[3], argv[4], argv[5]);
+    }
+    if (argc >= 3 && std::string_view{argv[1]} == "--ec-restore") {
+        return ecRestore({argv + 2, argv + argc});
+    }
+    if (argc >= 3 && std::string_view{argv[1]} == "--load") {
+        return load(argc, argv);
+    }
+    if (argc >= 3 && std::string_view{argv[1]} == "--udp-send") {
+        return udpSend(argc, argv);
+    }
+    if (argc >= 4 && std::string_view{argv[1]} == "--wan") {
+        return wan(argc, argv);
+    }
+    if (argc >= 3 && std::string_view{argv[1]} == "--serve") {
+        return serve(argc, argv);
+    }
+    if (argc >= 2 && std::string_view{argv[1]} == "--scale") {
+        return scale(argc, argv);
+    }
+    if (argc >= 2 && std::string_view{argv[1]} == "--bench") {
+        return runBenchmarks(argc, argv);
+    }
+    if (argc >= 2 && std::string_view{argv[1]} == "--versus") {
+        return versus(argc, argv);
+    }
+    if (argc >= 2 && std::string_view{argv[1]} == "--soak") {
+        return soak(argc, argv);
+    }
+
+    std::vector<std::unique_ptr<Stage>> stages;
+    std::string_view sinkSpec = "stdout";
+    const char* tracePath = nullptr;
+    bool countCpu = false;
+    std::optional<std::chrono::milliseconds> tcpInfoInterval;
+    bool rxTimestamps = false;
+    bool tune = false;
+    std::optional<ReadEngine> readEngine; // probed for if not given
+    bool reprobe = false;
+    bool udp = false;
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+        if (arg == "--workers" && i + 1 < argc) {
+            const auto count = parseCount(argv[++i]);
+            if (!count || *count == 0) {
+                usage();
+                return EXIT_FAILURE;
+            }
+            workers = *count;
+        }
+        else if (arg == "--stage" && i + 1 < argc) {
+            auto stage = makeStage(argv[++i]);
+            if (!stage) {
+                std::cerr << "unknown stage: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (auto err = stage->error()) {
+                std::cerr << stage->name() << ": " << *err << std::endl;
+                return EXIT_FAILURE;
+            }
+            stages.push_back(std::move(stage));
+        }
+        else if (arg == "--sink" && i + 1 < argc) {
+            sinkSpec = argv[++i];
+        }
+        else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        }
+        else if (arg == "--counters") {
+            countCpu = true;
+        }
+        else if (arg == "--tcp-info" && i + 1 < argc) {
+            const auto ms = parseCount(argv[++i]);
+            if (!ms || *ms == 0) {
+                usage();
+                return EXIT_FAILURE;
+            }
+            tcpInfoInterval = std::chrono::milliseconds{*ms};
+        }
+        else if (arg == "--rx-timestamps") {
+            rxTimestamps = true;
+        }
+        else if (arg == "--tune") {
+            tune = true;
+        }
+        else if (arg == "--read-engine" && i + 1 < argc) {
+            const std::string_view name = argv[++i];
+            readEngine = readEngineForName(name);
+            if (!readEngine && name != "auto") {
+                usage();
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "--reprobe") {
+            reprobe = true;
+        }
+        else if (arg == "--udp") {
+            udp = true;
+        }
+        else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    // those read the tcp connection; rudp has its own reader
+    if (udp && (tcpInfoInterval || readEngine)) {
+        std::cerr << "--tcp-info and --read-engine don't apply to --udp" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (rxTimestamps && !udp) {
+        std::cerr << "--rx-timestamps needs --udp, windows only stamps datagrams" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (tracePath) timeline.enable();
+
+    ThreadPool pool{Pipeline::threadsNeeded(stages.size()) + workers};
+    auto sink = makeSink(sinkSpec, pool);
+    if (!sink) {
+        std::cerr << "unknown sink: " << sinkSpec << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (auto err = sink->error()) {
+        std::cerr << *err << std::endl;
+        sink->abort();
+        return EXIT_FAILURE;
+    }
+    Pipeline pipeline{pool, *sink};
+    for (auto& stage : stages) pipeline.addStage(std::move(stage));
+
+    SocketDumper socketDumper{pipeline};
+    if (countCpu) socketDumper.countCpu();
+    if (tcpInfoInterval) socketDumper.sampleTcpInfo(*tcpInfoInterval);
+    if (rxTimestamps) socketDumper.useRxTimestamps();
+    if (tune) socketDumper.autoTune();
+    if (readEngine) socketDumper.useReadEngines({*readEngine, ReadEngine::recv});
+    else if (!udp) socketDumper.useReadEngines(engines::choose(reprobe));
+    socketDumper.initWsa();
+    if (udp) {
+        socketDumper.useUdp();
+        socketDumper.initUdpSocket(9999);
+        socketDumper.bindSocket();
+    }
+    else {
+        socketDumper.initTcpSocket(9999);
+        socketDumper.bindSocket();
+        socketDumper.listenSocket();
+        socketDumper.acceptSocket();
+    }
+    socketDumper.drainSocket();
+    socketDumper.dump();
+    if (tracePath && !timeline.write(tracePath)) {
+        std::cerr << "couldn't write trace to " << tracePath << std::endl;
+    }
+    return socketDumper.getExitCode();
+}